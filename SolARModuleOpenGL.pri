@@ -10,9 +10,45 @@ HEADERS += interfaces/SolAROpenglAPI.h \
     src/glcamera/trackball.hpp \
     src/glcamera/vector.hpp \
     src/glcamera/vector_fixed.hpp \
+    src/glutils/gl_functions.hpp \
+    src/glutils/gl_program.hpp \
+    src/glutils/gl_view.hpp \
+    src/glutils/gl_offscreen.hpp \
+    src/glutils/gl_readback.hpp \
+    src/glutils/gl_profiler.hpp \
+    src/glutils/gl_texture_upload.hpp \
+    src/pointcloud/point_cloud_buffer.hpp \
+    src/pointcloud/point_array_buffer.hpp \
+    src/pointcloud/scene_bounds.hpp \
+    src/pointcloud/worker_pool.hpp \
+    src/pointcloud/point_octree.hpp \
+    src/pointcloud/point_shader.hpp \
+    src/poses/pose_markers.hpp \
+    src/poses/pose_trajectory.hpp \
+    src/sink/image_pool.hpp \
+    src/viewer/frame_recorder.hpp \
+    src/viewer/triple_buffer.hpp \
+    src/viewer/viewer_scene.hpp \
     interfaces/SolARSinkPoseTextureBufferOpengl.h
 
 SOURCES += src/SolARModuleOpengl.cpp \
     src/SolAR3DPointsViewerOpengl.cpp \
     src/glcamera/gl_camera.cpp \
+    src/glutils/gl_functions.cpp \
+    src/glutils/gl_program.cpp \
+    src/glutils/gl_view.cpp \
+    src/glutils/gl_offscreen.cpp \
+    src/glutils/gl_readback.cpp \
+    src/glutils/gl_profiler.cpp \
+    src/glutils/gl_texture_upload.cpp \
+    src/pointcloud/point_cloud_buffer.cpp \
+    src/pointcloud/point_array_buffer.cpp \
+    src/pointcloud/scene_bounds.cpp \
+    src/pointcloud/worker_pool.cpp \
+    src/pointcloud/point_octree.cpp \
+    src/pointcloud/point_shader.cpp \
+    src/poses/pose_markers.cpp \
+    src/poses/pose_trajectory.cpp \
+    src/sink/image_pool.cpp \
+    src/viewer/frame_recorder.cpp \
     src/SolARSinkPoseTextureBufferOpengl.cpp
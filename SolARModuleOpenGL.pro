@@ -55,6 +55,8 @@ unix {
 
 linux {
     QMAKE_LFLAGS += -ldl
+    DEFINES += SOLAR_OPENGL_USE_EGL
+    LIBS += -lEGL
     LIBS += -L/home/linuxbrew/.linuxbrew/lib # temporary fix caused by grpc with -lre2 ... without -L in grpc.pc
 }
 
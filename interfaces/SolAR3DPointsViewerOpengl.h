@@ -16,6 +16,12 @@
 #ifndef SOLAR3DPOINTSVIEWEROPENGL_H
 #define SOLAR3DPOINTSVIEWEROPENGL_H
 
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include "api/display/I3DPointsViewer.h"
@@ -25,6 +31,20 @@
 #include "xpcf/component/ConfigurableBase.h"
 
 #include "src/glcamera/gl_camera.hpp"
+#include "src/glutils/gl_offscreen.hpp"
+#include "src/glutils/gl_profiler.hpp"
+#include "src/glutils/gl_readback.hpp"
+#include "src/pointcloud/point_cloud_buffer.hpp"
+#include "src/pointcloud/point_array_buffer.hpp"
+#include "src/pointcloud/point_octree.hpp"
+#include "src/pointcloud/point_shader.hpp"
+#include "src/pointcloud/scene_bounds.hpp"
+#include "src/pointcloud/worker_pool.hpp"
+#include "src/poses/pose_markers.hpp"
+#include "src/poses/pose_trajectory.hpp"
+#include "src/viewer/frame_recorder.hpp"
+#include "src/viewer/triple_buffer.hpp"
+#include "src/viewer/viewer_scene.hpp"
 
 namespace SolAR {
 namespace MODULES {
@@ -40,6 +60,7 @@ namespace OPENGL {
  * Configuration parameters allow user to visualize the axis of the coordinate systems of the world, the center of the point cloud, and the camera.
  * The color of points can be fixed, or can be the one assigned to each point.
  * The scale of the points, camera and coordinate systems axis can be defined by the usr thanks to configuration parameters.
+ * Several viewers can be used in the same process, each one with its own window (handled by the same thread) or offscreen. Offscreen viewers share their GPU resources.
  *
  * @SolARComponentPropertiesBegin
  * @SolARComponentProperty{ title,
@@ -99,6 +120,66 @@ namespace OPENGL {
  * @SolARComponentProperty{ zoomSensitivity,
  *                          zoom sensitivity,
  *                          @SolARComponentPropertyDescNum{ float, [0..MAX FLOAT], 10.f }}
+ * @SolARComponentProperty{ updateSceneBounds,
+ *                          if not 0\, the center and size of the scene are updated as the point cloud grows (without moving the view point),
+ *                          @SolARComponentPropertyDescNum{ uint, [0\,1], 1 }}
+ * @SolARComponentProperty{ asyncSceneBounds,
+ *                          if not 0\, the center and size of the scene are estimated on a worker thread after the first display,
+ *                          @SolARComponentPropertyDescNum{ uint, [0\,1], 1 }}
+ * @SolARComponentProperty{ packingThreads,
+ *                          number of threads used to convert the cloud points into vertices (0 for the number of hardware threads),
+ *                          @SolARComponentPropertyDescNum{ uint, [0..MAX INT], 0 }}
+ * @SolARComponentProperty{ levelOfDetail,
+ *                          if not 0\, large point clouds are drawn through an octree whose nodes are refined according to their size on screen,
+ *                          @SolARComponentPropertyDescNum{ uint, [0\,1], 1 }}
+ * @SolARComponentProperty{ lodScreenError,
+ *                          with levelOfDetail\, maximum spacing in pixels between the drawn points of a node before its children are drawn,
+ *                          @SolARComponentPropertyDescNum{ float, [0..MAX FLOAT], 1.5f }}
+ * @SolARComponentProperty{ frustumCulling,
+ *                          if not 0\, the parts of large point clouds and the keyframes and frames outside of the view are not drawn,
+ *                          @SolARComponentPropertyDescNum{ uint, [0\,1], 1 }}
+ * @SolARComponentProperty{ pointBudget,
+ *                          if not 0\, maximum number of points of the clouds drawn per frame while the view moves. When the view stops\, more points are drawn at each frame until the whole cloud is displayed,
+ *                          @SolARComponentPropertyDescNum{ uint, [0..MAX INT], 0 }}
+ * @SolARComponentProperty{ trajectory,
+ *                          if not 0\, the frame poses are drawn as a line strip through their positions instead of a sphere per pose. Only the poses appended since the previous display are sent to the GPU,
+ *                          @SolARComponentPropertyDescNum{ uint, [0\,1], 0 }}
+ * @SolARComponentProperty{ trajectoryMarkers,
+ *                          with trajectory\, if not 0\, a point is drawn on the trajectory every trajectoryMarkers frame poses,
+ *                          @SolARComponentPropertyDescNum{ uint, [0..MAX INT], 0 }}
+ * @SolARComponentProperty{ renderThread,
+ *                          if not 0\, the window is owned by a dedicated thread: display copies the scene\, packing the cloud points into vertices on the calling thread (linear in the number of points\, spread over packingThreads)\, hands it over and returns without waiting for the rendering (display must then be called from a single thread),
+ *                          @SolARComponentPropertyDescNum{ uint, [0\,1], 0 }}
+ * @SolARComponentProperty{ offscreen,
+ *                          if not 0\, no window is opened and the scene is rendered into an offscreen framebuffer of width x height pixels\, without any display server (requires a build with EGL),
+ *                          @SolARComponentPropertyDescNum{ uint, [0\,1], 0 }}
+ * @SolARComponentProperty{ readback,
+ *                          if not 0\, the rendered frames are copied back asynchronously to be returned by readFrame,
+ *                          @SolARComponentPropertyDescNum{ uint, [0\,1], 0 }}
+ * @SolARComponentProperty{ readbackBuffers,
+ *                          with readback\, number of frames being transferred at once. A frame can be read readbackBuffers - 1 frames after its rendering,
+ *                          @SolARComponentPropertyDescNum{ uint, [2..MAX INT], 3 }}
+ * @SolARComponentProperty{ readbackDownscale,
+ *                          with readback\, the frames are scaled down by this factor on the GPU before their transfer,
+ *                          @SolARComponentPropertyDescNum{ uint, [1..MAX INT], 1 }}
+ * @SolARComponentProperty{ recordPath,
+ *                          if not empty\, the rendered frames are recorded on a background thread. A path ending with .y4m is a YUV4MPEG2 video\, any other path is a printf pattern of numbered PPM images with a single %d conversion (e.g. frames/frame_%06d.ppm),
+ *                          @SolARComponentPropertyDescString{ "" }}
+ * @SolARComponentProperty{ recordQueueSize,
+ *                          maximum number of frames waiting to be written,
+ *                          @SolARComponentPropertyDescNum{ uint, [1..MAX INT], 16 }}
+ * @SolARComponentProperty{ recordDropPolicy,
+ *                          frame dropped when the queue of frames to record is full: newest (the new frame)\, oldest (the oldest queued frame) or block (the rendering waits for the writer),
+ *                          @SolARComponentPropertyDescString{ "newest" }}
+ * @SolARComponentProperty{ recordFrameRate,
+ *                          frame rate written in the header of a Y4M video,
+ *                          @SolARComponentPropertyDescNum{ uint, [1..MAX INT], 30 }}
+ * @SolARComponentProperty{ profiling,
+ *                          if not 0\, the durations of the stages of the display and of the rendering are measured on the CPU and on the GPU,
+ *                          @SolARComponentPropertyDescNum{ uint, [0\,1], 0 }}
+ * @SolARComponentProperty{ profilingPeriod,
+ *                          with profiling\, period in seconds of the log of the timings (never logged if 0),
+ *                          @SolARComponentPropertyDescNum{ float, [0..MAX FLOAT], 10.f }}
  * @SolARComponentProperty{ exitKey,
  *                          the key code to press to close the window. If negative\, no key is defined to close the window,
  *                          @SolARComponentPropertyDescNum{ int, [-1..MAX INT], 27 }}
@@ -147,8 +228,45 @@ public:
                                 const SRef<datastructure::PointCloud> points2 = nullptr,
                                 const std::vector<datastructure::Transform3Df> & keyframePoses2 = {}) override;
 
-protected:
-    static SolAR3DPointsViewerOpengl * m_instance;
+    /// @brief Display in a windows a 3D point cloud given as contiguous arrays as well as the current camera, and optionnally, the previous frames and keyframes.
+    /// The arrays are only read during the call and are uploaded as is to the GPU, without building any CloudPoint.
+    /// @param[in] positions, x, y, z coordinates of each point (3 * nbPoints floats defined in world coordinate system).
+    /// @param[in] colors (optional), r, g, b color of each point in [0..1] (3 * nbPoints floats). If null, the pointsColor property is used.
+    /// @param[in] labels (optional), semantic id of each point (nbPoints ints, negative if none), used when pointsColorFromClassLabel is not 0.
+    /// @param[in] nbPoints, the number of points.
+    /// @param[in] pose, poses of the current camera (transform of the camera defined in world corrdinate system).
+    /// @param[in] keyframesPoses (optional), poses of a set of keyframes (transform of the camera defined in world corrdinate system).
+    /// @param[in] framePoses (optional), poses of a set of frames (transform of the camera defined in world corrdinate system).
+    /// @param[in] keyframesPoses2 (optional), a second set of keyframes poses (transform of the camera defined in world corrdinate system).
+    /// @return FrameworkReturnCode::_SUCCESS if the window is created, else FrameworkReturnCode::_ERROR_
+    FrameworkReturnCode display(const float * positions,
+                                const float * colors,
+                                const int * labels,
+                                size_t nbPoints,
+                                const datastructure::Transform3Df & pose,
+                                const std::vector<datastructure::Transform3Df> & keyframePoses = {},
+                                const std::vector<datastructure::Transform3Df> & framePoses = {},
+                                const std::vector<datastructure::Transform3Df> & keyframePoses2 = {});
+
+    /// @brief Count the scenes given to display, and with renderThread, the ones drawn by the render thread and the ones replaced by a newer scene before being drawn.
+    /// @return the number of scenes produced, consumed and dropped
+    viewer_scene_counters sceneCounters() const;
+
+    /// @brief Get the last rendered frame copied back from the GPU when readback is not 0. The frames are transferred asynchronously, so a frame is available readbackLatency() frames after its rendering.
+    /// @return the frame as a BGR image, or nullptr if no new frame was read back since the last call
+    SRef<datastructure::Image> readFrame();
+
+    /// @brief Number of frames rendered after a frame before it can be returned by readFrame.
+    /// @return the latency in frames of the readback, 0 if readback is disabled
+    unsigned int readbackLatency() const;
+
+    /// @brief Count the frames given to the recording, the ones written to disk and the ones dropped when recordPath is not empty.
+    /// @return the number of frames submitted, written and dropped
+    frame_recorder_counters recordCounters() const;
+
+    /// @brief Timings of the stages of the display (display, packing) and of the rendering (upload, points, arrays, poses, swap, frame) when profiling is not 0.
+    /// @return for each stage, the percentiles of its last durations in milliseconds on the CPU and on the GPU
+    std::vector<stage_timing> stageTimings() const;
 
 private:
 
@@ -218,6 +336,66 @@ private:
     /// @brief zoom sensitivity
     float m_zoomSensitivity = 10.0f;
 
+    /// @brief if not null, the center and size of the scene are updated as the point cloud grows
+    unsigned int m_updateSceneBounds = 1;
+
+    /// @brief if not null, the center and size of the scene are estimated on a worker thread after the first display
+    unsigned int m_asyncSceneBounds = 1;
+
+    /// @brief number of threads used to convert the cloud points into vertices (0 for the number of hardware threads)
+    unsigned int m_packingThreads = 0;
+
+    /// @brief if not null, large point clouds are drawn through an octree whose nodes are refined according to their size on screen
+    unsigned int m_levelOfDetail = 1;
+
+    /// @brief with levelOfDetail, maximum spacing in pixels between the drawn points of a node before its children are drawn
+    float m_lodScreenError = 1.5f;
+
+    /// @brief if not null, the parts of large point clouds and the keyframes and frames outside of the view are not drawn
+    unsigned int m_frustumCulling = 1;
+
+    /// @brief if not null, maximum number of points of the clouds drawn per frame while the view moves
+    unsigned int m_pointBudget = 0;
+
+    /// @brief if not null, the frame poses are drawn as a line strip updated incrementally
+    unsigned int m_trajectory = 0;
+
+    /// @brief with trajectory, if not null, a point is drawn every trajectoryMarkers frame poses
+    unsigned int m_trajectoryMarkers = 0;
+
+    /// @brief if not null, the window is owned by a dedicated thread and display hands it a copy of the scene with packed points (from a single thread)
+    unsigned int m_renderThread = 0;
+
+    /// @brief if not null, the scene is rendered into an offscreen framebuffer instead of a window
+    unsigned int m_offscreen = 0;
+
+    /// @brief if not null, the rendered frames are copied back asynchronously through pixel buffers
+    unsigned int m_readback = 0;
+
+    /// @brief number of pixel buffers of the readback ring, the latency of the readback is one frame less
+    unsigned int m_readbackBuffers = 3;
+
+    /// @brief factor by which the frames are scaled down before their readback
+    unsigned int m_readbackDownscale = 1;
+
+    /// @brief path of the recorded video or printf pattern of the recorded images, no recording if empty
+    std::string m_recordPath = "";
+
+    /// @brief maximum number of frames waiting to be written
+    unsigned int m_recordQueueSize = 16;
+
+    /// @brief frame dropped when the recording queue is full: newest, oldest or block
+    std::string m_recordDropPolicy = "newest";
+
+    /// @brief frame rate of the recorded video
+    unsigned int m_recordFrameRate = 30;
+
+    /// @brief if not null, the durations of the display and rendering stages are measured
+    unsigned int m_profiling = 0;
+
+    /// @brief period in seconds of the log of the timings
+    float m_profilingPeriod = 10.f;
+
     /// @brief The key code to press to close the window. If negative, no key is defined to close the window
     int m_exitKey = 27;
 
@@ -243,23 +421,91 @@ private:
     int m_resetRotationKey = -1;
 
     int m_glWindowID = -1;
-    std::vector<SRef<datastructure::CloudPoint>> m_points;
-    std::vector<SRef<datastructure::CloudPoint>> m_points2;
+    point_cloud_buffer m_points;
+    point_cloud_buffer m_points2;
+    point_octree m_pointsOctree;
+    point_octree m_points2Octree;
+    point_array_buffer m_pointArrays;
+    std::unique_ptr<worker_pool> m_packingPool;
     datastructure::Transform3Df m_cameraPose;
-    std::vector<datastructure::Transform3Df> m_keyframePoses;
-    std::vector<datastructure::Transform3Df> m_keyframePoses2;
-    std::vector<datastructure::Transform3Df> m_framePoses;
+    pose_instances m_keyframeInstances;
+    pose_instances m_keyframe2Instances;
+    pose_instances m_frameInstances;
+    pose_trajectory m_frameTrajectory;
+    std::shared_ptr<pose_markers> m_poseMarkers;
+    GLUquadric * m_cornerQuadric = nullptr;               // spheres at the corners of the camera frustum
+    point_shader m_pointShader;
+    gl_offscreen m_offscreenContext;
+    gl_readback m_frameReadback;
+    std::mutex m_frameMutex;
+    SRef<datastructure::Image> m_lastFrame;
+    frame_recorder m_frameRecorder;
+    gl_profiler m_profiler;
+    frame_recorder::drop_policy m_recordPolicy = frame_recorder::DROP_NEWEST;
     gl_camera m_glcamera;
     datastructure::Point3Df m_sceneCenter;
     float m_sceneSize;
+    scene_bounds_estimator m_sceneBoundsEstimator;
+    scene_bounds m_sceneBounds;
+    size_t m_sceneBoundsNbPoints = 0;
     unsigned int m_resolutionX;
     unsigned int m_resolutionY;
-    bool m_exitKeyPressed = false;
+    std::atomic<bool> m_exitKeyPressed{false};
     bool m_firstDisplay = true;
+    gl_view m_lastView;
+    unsigned int m_idleFrames = 0;
+    bool m_pointBudgetReached = false;
+    bool m_windowVisible = true;
+    bool m_redrawRequested = false;
+    std::thread m_renderingThread;
+    triple_buffer<viewer_scene> m_scenes;
+    uint64_t m_nbScenes = 0;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_sceneAvailable;
+    std::atomic<bool> m_stopRendering{false};
     float m_rotationStep = 0.01;
     float m_rotationX = 0.0, m_rotationY = 0.0, m_rotationZ = 0.0;
 
     void rotate(const float rx, const float ry, const float rz);
+    bool createWindow();
+    bool initRendering();
+    void makeCurrent();
+    void destroyWindow();
+    void renderLoop(std::promise<bool> initialized);
+    void stopRenderThread();
+    void requestRedraw();
+    FrameworkReturnCode publishScene();
+    void setScene(const std::vector<SRef<datastructure::CloudPoint>> & points,
+                  const datastructure::Transform3Df & pose,
+                  const std::vector<datastructure::Transform3Df> & keyframePoses,
+                  const std::vector<datastructure::Transform3Df> & framePoses,
+                  const std::vector<SRef<datastructure::CloudPoint>> & points2,
+                  const std::vector<datastructure::Transform3Df> & keyframePoses2);
+    void setScene(const float * positions, const float * colors, const int * labels, size_t nbPoints,
+                  const datastructure::Transform3Df & pose,
+                  const std::vector<datastructure::Transform3Df> & keyframePoses,
+                  const std::vector<datastructure::Transform3Df> & framePoses,
+                  const std::vector<datastructure::Transform3Df> & keyframePoses2);
+    void setScene(const viewer_scene & scene);
+    void setCloudScene(const datastructure::Transform3Df & pose,
+                       const std::vector<datastructure::Transform3Df> & keyframePoses,
+                       const std::vector<datastructure::Transform3Df> & framePoses,
+                       const std::vector<datastructure::Transform3Df> & keyframePoses2);
+    point_color_options colorOptions(const std::vector<unsigned int> & color) const;
+    bool useOctree(const point_cloud_buffer & points) const;
+    size_t drawPoints(point_cloud_buffer & points, point_octree & octree, const std::vector<unsigned int> & color,
+                      const gl_view & view, size_t budget);
+    void setPoses(const datastructure::Transform3Df & pose,
+                  const std::vector<datastructure::Transform3Df> & keyframePoses,
+                  const std::vector<datastructure::Transform3Df> & framePoses,
+                  const std::vector<datastructure::Transform3Df> & keyframePoses2);
+    bool needSceneBounds(size_t nbPoints) const;
+    void submitSceneBounds(scene_samples && samples, size_t nbPoints);
+    void updateScene();
+    bool uploadPending() const;
+    void uploadScene();
+    FrameworkReturnCode processEvents();
+    void collectFrame();
 
     void OnMainLoop() ;
     void OnRender() ;
@@ -267,32 +513,47 @@ private:
     void OnKeyBoard(unsigned char key, int x, int y) ;
     void OnMouseMotion(int x, int y);
     void OnMouseState(int button, int state, int x, int y);
+    void OnWindowStatus(int state);
+
+    // viewer of the current GLUT window, null if the window is closed
+    static SolAR3DPointsViewerOpengl * windowViewer();
 
     static void MainLoop()
     {
-        m_instance->OnMainLoop();
+        if (SolAR3DPointsViewerOpengl * viewer = windowViewer())
+            viewer->OnMainLoop();
     }
 
     static void Render()
     {
-        m_instance->OnRender();
+        if (SolAR3DPointsViewerOpengl * viewer = windowViewer())
+            viewer->OnRender();
     }
     static void ResizeWindow(int _w , int _h)
     {
-        m_instance->OnResizeWindow(_w, _h);
+        if (SolAR3DPointsViewerOpengl * viewer = windowViewer())
+            viewer->OnResizeWindow(_w, _h);
     }
     static void KeyBoard(unsigned char key, int x, int y)
     {
-        m_instance->OnKeyBoard(key, x , y);
+        if (SolAR3DPointsViewerOpengl * viewer = windowViewer())
+            viewer->OnKeyBoard(key, x , y);
     }
 
     static void MouseMotion(int x, int y)
     {
-        m_instance->OnMouseMotion(x,  y);
+        if (SolAR3DPointsViewerOpengl * viewer = windowViewer())
+            viewer->OnMouseMotion(x,  y);
     }
     static void MouseState(int button, int state, int x, int y)
     {
-        m_instance->OnMouseState(button, state, x , y);
+        if (SolAR3DPointsViewerOpengl * viewer = windowViewer())
+            viewer->OnMouseState(button, state, x , y);
+    }
+    static void WindowStatus(int state)
+    {
+        if (SolAR3DPointsViewerOpengl * viewer = windowViewer())
+            viewer->OnWindowStatus(state);
     }
 };
 
@@ -27,7 +27,13 @@
 #else
 #include "freeglut.h"
 #endif
-#include <mutex>
+#include <atomic>
+#include <vector>
+
+#include "src/glutils/gl_profiler.hpp"
+#include "src/glutils/gl_texture_upload.hpp"
+#include "src/sink/image_pool.hpp"
+#include "src/viewer/triple_buffer.hpp"
 
 namespace SolAR {
 namespace MODULES {
@@ -39,6 +45,30 @@ namespace OPENGL {
  * <TT>UUID: 3af7813c-4647-4d70-9cc6-e3cedd8dd77c</TT>
  *
  * This component allows to make available a pose to a third party application and to update a OpenGL texture buffer with a new image.
+ * The poses and images are exchanged through wait-free triple buffers: set must be called from a single pipeline thread,
+ * updateFrameDataOGL from the render thread and udpate/tryUpdate from a single application thread. None of them waits for another:
+ * the copies of the images go back to the pipeline through the same buffers, the image pool (and its lock) only serves the changes of
+ * image format.
+ * RGB, BGR (with alpha or padding) and grey images are uploaded as is: the channels are reordered by the upload and grey levels
+ * are replicated to the color channels by the swizzle of the texture (OpenGL 3.3 or ARB_texture_swizzle), so no conversion is done on the CPU.
+ *
+ * @SolARComponentPropertiesBegin
+ * @SolARComponentProperty{ shareImages,
+ *                          if not 0\, the images given to set are kept without being copied: the producer must not modify an image once given to the sink. Otherwise images are copied into buffers recycled from a pool,
+ *                          @SolARComponentPropertyDescNum{ uint, [0\,1], 0 }}
+ * @SolARComponentProperty{ imagePoolSize,
+ *                          maximum number of free image buffers kept to receive the copies of the images when their format changes (if 0\, each buffer is allocated),
+ *                          @SolARComponentPropertyDescNum{ uint, [0..MAX INT], 3 }}
+ * @SolARComponentProperty{ uploadBuffers,
+ *                          number of pixel buffers through which the images are uploaded asynchronously to the texture (if 0\, the texture is updated from client memory),
+ *                          @SolARComponentPropertyDescNum{ uint, [0..MAX INT], 2 }}
+ * @SolARComponentProperty{ profiling,
+ *                          if not 0\, the duration of the texture update is measured on the CPU\, and on the GPU if the context supports timer queries,
+ *                          @SolARComponentPropertyDescNum{ uint, [0\,1], 0 }}
+ * @SolARComponentProperty{ profilingPeriod,
+ *                          with profiling\, period in seconds of the log of the timings (never logged if 0),
+ *                          @SolARComponentPropertyDescNum{ float, [0..MAX FLOAT], 10.f }}
+ * @SolARComponentPropertiesEnd
  */
 
 class SOLAROPENGL_EXPORT_API SinkPoseTextureBuffer : public org::bcom::xpcf::ConfigurableBase,
@@ -65,29 +95,87 @@ public:
     void updateFrameDataOGL(int enventID) override;
 
     /// @brief Provide an access to the new pose and update the texture buffer with the new image.
-    /// The implementation of this interface must be thread safe
+    /// Wait-free, to call from a single application thread (the same as for tryUpdate)
     /// @param[in,out] pose the new pose made available by the pipeline.
     /// @return return FrameworkReturnCode::_SUCCESS if a new pose and image are available, otherwise frameworkReturnCode::_ERROR.
     api::sink::SinkReturnCode udpate(datastructure::Transform3Df& pose) override;
 
     /// @brief Provide an access to the new pose and update the texture buffer with the new image only if the image and the pose have been updated by the pipeline.
-    /// The implementation of this interface must be thread safe
+    /// Wait-free, to call from a single application thread (the same as for udpate)
     /// @param[in,out] pose the new pose made available by the pipeline.
     /// @return return FrameworkReturnCode::_SUCCESS if a new pose and image are available, otherwise frameworkReturnCode::_ERROR.
     api::sink::SinkReturnCode tryUpdate(datastructure::Transform3Df& pose) override;
 
+    /// @brief Timings of the texture update (update stage) when profiling is not 0.
+    /// @return the percentiles of the last durations in milliseconds on the CPU and on the GPU
+    std::vector<stage_timing> stageTimings() const;
+
+    /// @brief Count the buffers of the image copies taken from the pool (at the first images and at each change of format) and the ones that required an allocation when shareImages is 0.
+    /// @return the numbers of images acquired, allocated (misses) and evicted, the free images and the maximum number of images in use at once
+    image_pool_counters imagePoolCounters() const;
+
+    /// @brief Sequence number of the frame of the image last uploaded to the texture.
+    /// The images and poses are numbered from 1 by set, a pose and an image given together share the same number.
+    /// @return the sequence number of the texture content, 0 if no image has been uploaded
+    uint64_t imageSequence() const;
+
+    /// @brief Sequence number of the frame of the pose last returned by udpate.
+    /// @return the sequence number of the pose, 0 if no pose has been returned
+    uint64_t poseSequence() const;
+
+    /// @brief Free the pixel buffers and the timer queries of the texture update, which belong to the context of the texture.
+    /// To call from the render thread with this context current, before the context is destroyed. The next update creates them again.
+    void release();
+
+    org::bcom::xpcf::XPCFErrorCode onConfigured() override final;
+
     void unloadComponent () override final;
 
 private:
-    SRef<datastructure::Image> m_image;
-    datastructure::Transform3Df m_pose;
-    GLuint m_textureHandle;
+    /// @brief if not null, the images given to set are kept instead of being copied
+    unsigned int m_shareImages = 0;
+
+    /// @brief maximum number of free image buffers kept for the copies of the images
+    unsigned int m_imagePoolSize = 3;
+
+    /// @brief number of pixel buffers of the asynchronous upload ring, 0 to update the texture from client memory
+    unsigned int m_uploadBuffers = 2;
+
+    /// @brief if not null, the duration of the texture update is measured
+    unsigned int m_profiling = 0;
+
+    /// @brief period in seconds of the log of the timings
+    float m_profilingPeriod = 10.f;
+
+    // pose of a frame exchanged between the pipeline and the application
+    struct pose_slot {
+        datastructure::Transform3Df pose = datastructure::Transform3Df::Identity();
+        uint64_t sequence = 0;
+    };
+
+    // image of a frame exchanged between the pipeline and the render thread
+    struct image_slot {
+        SRef<datastructure::Image> image;
+        uint64_t sequence = 0;
+    };
+
+    // fill the back image slot with the given image if shared, otherwise with a copy, and publish it
+    // called by the pipeline thread only
+    void publishImage(const SRef<datastructure::Image> & image, uint64_t sequence);
+
+    triple_buffer<image_slot> m_images;
+    triple_buffer<pose_slot> m_poses;
+    uint64_t m_sequence = 0;                              // last frame given by the pipeline
+    std::atomic<uint64_t> m_imageSequence{0};
+    std::atomic<uint64_t> m_poseSequence{0};
+    image_pool m_imagePool;                               // buffers of the images copied by the sink
+    std::atomic<GLuint> m_textureHandle{0};
     size_t m_textureBufferSize;
 
-    bool m_newPose;
-    bool m_newImage;
-
-    std::mutex m_mutex;
+    bool m_glResolved = false;                            // the entry points were resolved, with or without success
+    gl_texture_upload m_textureUpload;
+    bool m_textureUploadInitialized = false;
+    gl_profiler m_profiler;
 
 };
 
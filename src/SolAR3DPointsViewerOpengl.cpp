@@ -17,6 +17,7 @@
 #include "SolAR3DPointsViewerOpengl.h"
 #include "core/Log.h"
 #include "xpcf/core/helpers.h"
+#include <algorithm>
 #include <map>
 #include <math.h>
 #include <random>
@@ -37,7 +38,52 @@ static Transform3Df SolAR2GL = [] {
   return Transform3Df(matrix);
 }();
 
-SolAR3DPointsViewerOpengl * SolAR3DPointsViewerOpengl::m_instance = NULL ;
+// below this size, a cloud is drawn with a single call
+static const size_t OCTREE_MIN_POINTS = 500000;
+
+// maximum delay of the render thread to process the window events
+static const std::chrono::milliseconds RENDER_THREAD_PERIOD(10);
+
+// size in pixels of the points marking the trajectory of the frames
+static const float TRAJECTORY_MARKER_SIZE = 5.f;
+
+// stages measured with profiling, declared in this order
+enum stage {
+    DISPLAY_STAGE,                                        // call to display, until the scene is handed over to the render thread
+    PACKING_STAGE,                                        // conversion of the cloud points into vertices, by the caller of display
+    UPLOAD_STAGE,                                         // upload of the vertices and poses to the GPU
+    POINTS_STAGE,                                         // draw of the point clouds
+    ARRAYS_STAGE,                                         // draw of the point arrays
+    POSES_STAGE,                                          // draw of the camera, axes, keyframes and frames
+    SWAP_STAGE,                                           // swap of the window buffers
+    FRAME_STAGE                                           // whole frame
+};
+
+// viewers of the GLUT windows, GLUT callbacks are dispatched to the viewer of the current window
+static std::mutex s_windowsMutex;
+static std::map<int, SolAR3DPointsViewerOpengl *> s_windowViewers;
+static bool s_threadedWindow = false;
+
+// pose marker meshes and shader shared by the offscreen viewers, whose contexts share their objects
+static std::mutex s_sharedMutex;
+static std::weak_ptr<pose_markers> s_sharedPoseMarkers;
+
+SolAR3DPointsViewerOpengl * SolAR3DPointsViewerOpengl::windowViewer()
+{
+    std::lock_guard<std::mutex> lock(s_windowsMutex);
+    auto viewer = s_windowViewers.find(glutGetWindow());
+    return viewer == s_windowViewers.end() ? nullptr : viewer->second;
+}
+
+static void unregisterWindow(int window, SolAR3DPointsViewerOpengl * viewer)
+{
+    std::lock_guard<std::mutex> lock(s_windowsMutex);
+    auto found = s_windowViewers.find(window);
+    if (found != s_windowViewers.end() && found->second == viewer) {
+        s_windowViewers.erase(found);
+        s_threadedWindow = false;
+    }
+}
 
 SolAR3DPointsViewerOpengl::SolAR3DPointsViewerOpengl():ConfigurableBase(xpcf::toUUID<SolAR3DPointsViewerOpengl>())
 {
@@ -64,6 +110,26 @@ SolAR3DPointsViewerOpengl::SolAR3DPointsViewerOpengl():ConfigurableBase(xpcf::to
     declareProperty("pointSize", m_pointSize);
     declareProperty("cameraScale", m_cameraScale);
     declareProperty("zoomSensitivity", m_zoomSensitivity);
+    declareProperty("updateSceneBounds", m_updateSceneBounds);
+    declareProperty("asyncSceneBounds", m_asyncSceneBounds);
+    declareProperty("packingThreads", m_packingThreads);
+    declareProperty("levelOfDetail", m_levelOfDetail);
+    declareProperty("lodScreenError", m_lodScreenError);
+    declareProperty("frustumCulling", m_frustumCulling);
+    declareProperty("pointBudget", m_pointBudget);
+    declareProperty("trajectory", m_trajectory);
+    declareProperty("trajectoryMarkers", m_trajectoryMarkers);
+    declareProperty("renderThread", m_renderThread);
+    declareProperty("offscreen", m_offscreen);
+    declareProperty("readback", m_readback);
+    declareProperty("readbackBuffers", m_readbackBuffers);
+    declareProperty("readbackDownscale", m_readbackDownscale);
+    declareProperty("recordPath", m_recordPath);
+    declareProperty("recordQueueSize", m_recordQueueSize);
+    declareProperty("recordDropPolicy", m_recordDropPolicy);
+    declareProperty("recordFrameRate", m_recordFrameRate);
+    declareProperty("profiling", m_profiling);
+    declareProperty("profilingPeriod", m_profilingPeriod);
     declareProperty("exitKey", m_exitKey);
     declareProperty("increaseRotationXKey", m_increaseRotationXKey);
     declareProperty("decreaseRotationXKey", m_decreaseRotationXKey);
@@ -73,27 +139,36 @@ SolAR3DPointsViewerOpengl::SolAR3DPointsViewerOpengl():ConfigurableBase(xpcf::to
     declareProperty("decreaseRotationZKey", m_decreaseRotationZKey);
     declareProperty("resetRotationKey", m_resetRotationKey);
     declareProperty("rotationStep", m_rotationStep);
-    m_instance = this ;
+    m_profiler.add_stage("display", false);
+    m_profiler.add_stage("packing", false);
+    m_profiler.add_stage("upload", true);
+    m_profiler.add_stage("points", true);
+    m_profiler.add_stage("arrays", true);
+    m_profiler.add_stage("poses", true);
+    m_profiler.add_stage("swap", false);
+    m_profiler.add_stage("frame", false);
 
 	LOG_DEBUG(" SolAR3DPointsViewerOpengl constructor");
 }
 
 SolAR3DPointsViewerOpengl::~SolAR3DPointsViewerOpengl()
 {
+    stopRenderThread();
+    // without render thread, the context and the window are still alive until here
+    if (m_offscreenContext.valid() || m_glWindowID > 0)
+        destroyWindow();
     LOG_DEBUG(" SolAR3DPointsViewerOpengl destructor")
 }
 
 xpcf::XPCFErrorCode SolAR3DPointsViewerOpengl::onConfigured()
 {
     LOG_DEBUG(" SolAR3DPointsViewerOpengl onConfigured");
-    char *myargv [1];
-    int myargc=1;
-    myargv [0]=strdup (m_title.c_str());
-    glutInit(&myargc, myargv);
-    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);
-
     m_resolutionX = m_width;
     m_resolutionY = m_height;
+    m_packingPool.reset(new worker_pool(m_packingThreads));
+    m_profiler.enable(m_profiling != 0);
+    m_points.record_changes(m_levelOfDetail || m_frustumCulling || m_pointBudget);
+    m_points2.record_changes(m_levelOfDetail || m_frustumCulling || m_pointBudget);
 
     if (m_usePointsColorFromClassLabel>0) {
         if (m_classLabelColorMapPath.empty()) {
@@ -120,15 +195,24 @@ xpcf::XPCFErrorCode SolAR3DPointsViewerOpengl::onConfigured()
         }
     }
 
-    glutInitWindowSize(m_width, m_height);
-    m_glWindowID = glutCreateWindow(m_title.c_str());
-    glutDisplayFunc(Render);
-    glutKeyboardFunc(KeyBoard);
-    glutMouseFunc(MouseState);
-    glutMotionFunc(MouseMotion);
-    glutReshapeFunc(ResizeWindow);
-    glutIdleFunc(MainLoop);
-    glutMainLoopEvent();
+    if (!frame_recorder::parse_policy(m_recordDropPolicy, m_recordPolicy)) {
+        LOG_ERROR("unknown recordDropPolicy {}, expected newest, oldest or block", m_recordDropPolicy);
+        return xpcf::XPCFErrorCode::_FAIL;
+    }
+
+    if (m_renderThread) {
+        // the window and its context belong to the render thread
+        std::promise<bool> initialized;
+        std::future<bool> windowCreated = initialized.get_future();
+        m_stopRendering = false;
+        m_renderingThread = std::thread(&SolAR3DPointsViewerOpengl::renderLoop, this, std::move(initialized));
+        if (!windowCreated.get()) {
+            m_renderingThread.join();
+            return xpcf::XPCFErrorCode::_FAIL;
+        }
+    }
+    else if (!createWindow())
+        return xpcf::XPCFErrorCode::_FAIL;
 
     LOG_INFO("**************************************************");
     LOG_INFO("Keys defined for view rotation:");
@@ -172,6 +256,188 @@ xpcf::XPCFErrorCode SolAR3DPointsViewerOpengl::onConfigured()
     return xpcf::XPCFErrorCode::_SUCCESS;
 }
 
+bool SolAR3DPointsViewerOpengl::createWindow()
+{
+    if (m_offscreen) {
+        // no window system at all, the context and its framebuffer are created by EGL
+        if (!m_offscreenContext.create(m_width, m_height))
+            return false;
+        m_redrawRequested = true;
+        return initRendering();
+    }
+
+    {
+        // GLUT is not thread safe, all the windows must be handled by the same thread
+        std::lock_guard<std::mutex> lock(s_windowsMutex);
+        if (s_threadedWindow || (m_renderThread && !s_windowViewers.empty())) {
+            LOG_ERROR("A window with renderThread can not be opened along with other windows, use offscreen for the other viewers");
+            return false;
+        }
+        // GLUT is initialized once for all the windows of the process
+        if (glutGet(GLUT_INIT_STATE) == 0) {
+            char *myargv [1];
+            int myargc=1;
+            myargv [0]=strdup (m_title.c_str());
+            glutInit(&myargc, myargv);
+        }
+        glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);
+
+        glutInitWindowSize(m_width, m_height);
+        m_glWindowID = glutCreateWindow(m_title.c_str());
+        s_windowViewers[m_glWindowID] = this;
+        s_threadedWindow = m_renderThread != 0;
+    }
+    glutDisplayFunc(Render);
+    glutKeyboardFunc(KeyBoard);
+    glutMouseFunc(MouseState);
+    glutMotionFunc(MouseMotion);
+    glutReshapeFunc(ResizeWindow);
+    glutWindowStatusFunc(WindowStatus);
+    glutIdleFunc(MainLoop);
+    glutMainLoopEvent();
+
+    if (!gl::load(glutGetProcAddress)) {
+        LOG_ERROR("OpenGL 1.5 vertex buffer objects are required to display point clouds");
+        return false;
+    }
+    return initRendering();
+}
+
+bool SolAR3DPointsViewerOpengl::initRendering()
+{
+    if (m_offscreen) {
+        std::lock_guard<std::mutex> lock(s_sharedMutex);
+        m_poseMarkers = s_sharedPoseMarkers.lock();
+    }
+    if (!m_poseMarkers) {
+        m_poseMarkers = std::make_shared<pose_markers>();
+        m_poseMarkers->init();
+        if (m_offscreen) {
+            std::lock_guard<std::mutex> lock(s_sharedMutex);
+            s_sharedPoseMarkers = m_poseMarkers;
+        }
+    }
+    m_pointShader.init();
+    m_pointShader.set_color_map(m_colorMap);
+    // with GLU rather than GLUT, which is not initialized when rendering offscreen
+    m_cornerQuadric = gluNewQuadric();
+    // frames are recorded through the readback
+    bool recording = !m_recordPath.empty();
+    if ((m_readback || recording) && !m_frameReadback.init(m_readbackBuffers, m_readbackDownscale))
+        return false;
+    if (recording && !m_frameRecorder.open(m_recordPath, m_recordQueueSize, m_recordPolicy, m_recordFrameRate))
+        return false;
+    return true;
+}
+
+void SolAR3DPointsViewerOpengl::makeCurrent()
+{
+    // several viewers may render on the same thread
+    if (m_offscreen)
+        m_offscreenContext.make_current();
+    else if (m_glWindowID > 0 && glutGetWindow() != m_glWindowID)
+        glutSetWindow(m_glWindowID);
+}
+
+void SolAR3DPointsViewerOpengl::destroyWindow()
+{
+    makeCurrent();
+    m_glcamera.clear(0.0, 0.0, 0.0, 1.0);
+    m_points.release();
+    m_points2.release();
+    m_pointsOctree.release();
+    m_points2Octree.release();
+    m_pointArrays.release();
+    m_keyframeInstances.release();
+    m_keyframe2Instances.release();
+    m_frameInstances.release();
+    m_frameTrajectory.release();
+    {
+        // the shared markers are freed with their last viewer
+        std::lock_guard<std::mutex> lock(s_sharedMutex);
+        if (m_poseMarkers.use_count() == 1)
+            m_poseMarkers->release();
+        m_poseMarkers.reset();
+    }
+    m_pointShader.release();
+    if (m_cornerQuadric != nullptr)
+        gluDeleteQuadric(m_cornerQuadric);
+    m_cornerQuadric = nullptr;
+    m_frameReadback.release();
+    m_frameRecorder.close();
+    m_profiler.release();
+    if (m_offscreen) {
+        m_offscreenContext.release();
+        return;
+    }
+    unregisterWindow(m_glWindowID, this);
+    glutDestroyWindow(m_glWindowID);
+    m_glWindowID = -1;
+    glutMainLoopEvent();
+}
+
+void SolAR3DPointsViewerOpengl::renderLoop(std::promise<bool> initialized)
+{
+    bool created = createWindow();
+    initialized.set_value(created);
+    if (!created)
+        return;
+
+    while (true) {
+        {
+            // the producer never takes this lock, a missed notification only delays the scene by RENDER_THREAD_PERIOD
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            // poll the window events at least every RENDER_THREAD_PERIOD, without waiting while the view is animated
+            bool animated = m_rotationX != 0.f || m_rotationY != 0.f || m_rotationZ != 0.f || m_pointBudgetReached;
+            m_sceneAvailable.wait_for(lock, animated ? std::chrono::milliseconds(0) : RENDER_THREAD_PERIOD,
+                                      [this] { return m_scenes.fresh() || m_stopRendering; });
+        }
+        if (m_stopRendering)
+            break;
+        if (m_scenes.consume())
+            setScene(m_scenes.front());
+        if (processEvents() == FrameworkReturnCode::_STOP)
+            return;
+    }
+    destroyWindow();
+}
+
+void SolAR3DPointsViewerOpengl::stopRenderThread()
+{
+    if (!m_renderingThread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopRendering = true;
+    }
+    m_sceneAvailable.notify_one();
+    m_renderingThread.join();
+    viewer_scene_counters counters = sceneCounters();
+    LOG_INFO("3D points viewer scenes: {} produced, {} consumed, {} dropped", counters.produced, counters.consumed, counters.dropped);
+}
+
+FrameworkReturnCode SolAR3DPointsViewerOpengl::publishScene()
+{
+    // a scene not yet taken by the render thread is replaced by the newer one
+    m_scenes.publish();
+    m_sceneAvailable.notify_one();
+    return m_exitKeyPressed ? FrameworkReturnCode::_STOP : FrameworkReturnCode::_SUCCESS;
+}
+
+viewer_scene_counters SolAR3DPointsViewerOpengl::sceneCounters() const
+{
+    viewer_scene_counters counters;
+    if (m_renderThread) {
+        counters.produced = m_scenes.produced();
+        counters.consumed = m_scenes.consumed();
+        counters.dropped = m_scenes.dropped();
+    }
+    else
+        // each scene is drawn by the call to display
+        counters.produced = counters.consumed = m_nbScenes;
+    return counters;
+}
+
 FrameworkReturnCode SolAR3DPointsViewerOpengl::display (const std::vector<SRef<CloudPoint>> & points,
                                                         const Transform3Df & pose,
                                                         const std::vector<Transform3Df> & keyframePoses,
@@ -179,55 +445,309 @@ FrameworkReturnCode SolAR3DPointsViewerOpengl::display (const std::vector<SRef<C
                                                         const std::vector<SRef<CloudPoint>> & points2,
                                                         const std::vector<Transform3Df> & keyframePoses2)
 {
-    m_points = points;
-    m_points2 = points2;
-    m_cameraPose = pose;
-    m_framePoses = framePoses;
-    m_keyframePoses = keyframePoses;
-    m_keyframePoses2 = keyframePoses2;
-
-    if (m_firstDisplay)
-    {
-        // Compute the center point of the point cloud
-		std::vector<float> xValues, yValues, zValues;
-		int nbPoints = m_points.size();
-        for (int i = 0; i < nbPoints; i++)
+    if (m_renderThread) {
+        gl_profiler::scope measure(m_profiler, DISPLAY_STAGE);
+        viewer_scene & scene = m_scenes.back();
+        scene.arrays = false;
         {
-			xValues.push_back(m_points[i]->getX());
-			yValues.push_back(m_points[i]->getY());
-			zValues.push_back(m_points[i]->getZ());
+            // the render thread only receives copies of the points, the pool is not used by the render thread
+            gl_profiler::scope measurePacking(m_profiler, PACKING_STAGE);
+            scene.points.pack(points, m_packingPool.get());
+            scene.points2.pack(points2, m_packingPool.get());
         }
-		std::sort(xValues.begin(), xValues.end());
-		std::sort(yValues.begin(), yValues.end());
-		std::sort(zValues.begin(), zValues.end());        
+        scene.pose = pose;
+        scene.keyframe_poses = keyframePoses;
+        scene.frame_poses = framePoses;
+        scene.keyframe_poses2 = keyframePoses2;
+        return publishScene();
+    }
+    ++m_nbScenes;
+    {
+        gl_profiler::scope measure(m_profiler, DISPLAY_STAGE);
+        setScene(points, pose, keyframePoses, framePoses, points2, keyframePoses2);
+    }
+    return processEvents();
+}
 
-        // Center the scene on the center of the point cloud
-        m_sceneCenter = Point3Df(xValues[nbPoints / 2], yValues[nbPoints / 2], zValues[nbPoints / 2]);        
+void SolAR3DPointsViewerOpengl::setScene(const std::vector<SRef<CloudPoint>> & points,
+                                         const Transform3Df & pose,
+                                         const std::vector<Transform3Df> & keyframePoses,
+                                         const std::vector<Transform3Df> & framePoses,
+                                         const std::vector<SRef<CloudPoint>> & points2,
+                                         const std::vector<Transform3Df> & keyframePoses2)
+{
+    makeCurrent();
+    {
+        gl_profiler::scope measure(m_profiler, PACKING_STAGE);
+        m_points.set_points(points, m_packingPool.get());
+        m_points2.set_points(points2, m_packingPool.get());
+    }
+    setCloudScene(pose, keyframePoses, framePoses, keyframePoses2);
+}
 
-        // Copmute the diagonal of the box to define the scene Size
-		Vector3f sceneDiagonal;
-        sceneDiagonal(0) = std::abs(xValues[nbPoints * 0.99] - xValues[nbPoints * 0.01]);
-        sceneDiagonal(1) = std::abs(yValues[nbPoints * 0.99] - yValues[nbPoints * 0.01]);
-        sceneDiagonal(2) = std::abs(zValues[nbPoints * 0.99] - zValues[nbPoints * 0.01]);
-        m_sceneSize = sceneDiagonal.norm();
+void SolAR3DPointsViewerOpengl::setCloudScene(const Transform3Df & pose,
+                                              const std::vector<Transform3Df> & keyframePoses,
+                                              const std::vector<Transform3Df> & framePoses,
+                                              const std::vector<Transform3Df> & keyframePoses2)
+{
+    if (useOctree(m_points))
+        m_pointsOctree.sync(m_points);
+    if (useOctree(m_points2))
+        m_points2Octree.sync(m_points2);
+    setPoses(pose, keyframePoses, framePoses, keyframePoses2);
+    m_pointArrays.clear();
+
+    if (needSceneBounds(m_points.size()))
+    {
+        scene_samples samples;
+        samples.sample(m_points.vertices());
+        submitSceneBounds(std::move(samples), m_points.size());
+    }
+    updateScene();
+    // new data to draw
+    requestRedraw();
+}
 
-        // Set the camera according to the center and the size of the scene.
-        m_glcamera.resetview(math_vector_3f(m_sceneCenter.getX(), m_sceneCenter.getY(), m_sceneCenter.getZ()), m_sceneSize);
+FrameworkReturnCode SolAR3DPointsViewerOpengl::display(const float * positions,
+                                                       const float * colors,
+                                                       const int * labels,
+                                                       size_t nbPoints,
+                                                       const Transform3Df & pose,
+                                                       const std::vector<Transform3Df> & keyframePoses,
+                                                       const std::vector<Transform3Df> & framePoses,
+                                                       const std::vector<Transform3Df> & keyframePoses2)
+{
+    if (positions == nullptr && nbPoints > 0) {
+        LOG_ERROR("positions of the {} points to display are not defined", nbPoints);
+        return FrameworkReturnCode::_ERROR_;
+    }
+    if (m_renderThread) {
+        // the arrays are only borrowed for the duration of the call
+        gl_profiler::scope measure(m_profiler, DISPLAY_STAGE);
+        viewer_scene & scene = m_scenes.back();
+        scene.arrays = true;
+        scene.points.clear();
+        scene.points2.clear();
+        scene.positions.assign(positions, positions + 3 * nbPoints);
+        scene.colors.clear();
+        if (colors)
+            scene.colors.assign(colors, colors + 3 * nbPoints);
+        scene.labels.clear();
+        if (labels)
+            scene.labels.assign(labels, labels + nbPoints);
+        scene.pose = pose;
+        scene.keyframe_poses = keyframePoses;
+        scene.frame_poses = framePoses;
+        scene.keyframe_poses2 = keyframePoses2;
+        return publishScene();
+    }
+    ++m_nbScenes;
+    {
+        gl_profiler::scope measure(m_profiler, DISPLAY_STAGE);
+        setScene(positions, colors, labels, nbPoints, pose, keyframePoses, framePoses, keyframePoses2);
+    }
+    return processEvents();
+}
 
+void SolAR3DPointsViewerOpengl::setScene(const float * positions,
+                                         const float * colors,
+                                         const int * labels,
+                                         size_t nbPoints,
+                                         const Transform3Df & pose,
+                                         const std::vector<Transform3Df> & keyframePoses,
+                                         const std::vector<Transform3Df> & framePoses,
+                                         const std::vector<Transform3Df> & keyframePoses2)
+{
+    makeCurrent();
+    m_points.clear();
+    m_points2.clear();
+    setPoses(pose, keyframePoses, framePoses, keyframePoses2);
+    {
+        // the poses are uploaded along with the arrays, so that the stage has a single measure per scene
+        gl_profiler::scope measure(m_profiler, UPLOAD_STAGE);
+        m_pointArrays.set_arrays(positions, colors, labels, nbPoints);
+        uploadScene();
+    }
+
+    if (needSceneBounds(nbPoints))
+    {
+        scene_samples samples;
+        samples.sample(positions, nbPoints);
+        submitSceneBounds(std::move(samples), nbPoints);
+    }
+    updateScene();
+    requestRedraw();
+}
+
+void SolAR3DPointsViewerOpengl::setScene(const viewer_scene & scene)
+{
+    if (scene.arrays)
+        setScene(scene.positions.data(), scene.colors.empty() ? nullptr : scene.colors.data(),
+                 scene.labels.empty() ? nullptr : scene.labels.data(), scene.positions.size() / 3,
+                 scene.pose, scene.keyframe_poses, scene.frame_poses, scene.keyframe_poses2);
+    else {
+        makeCurrent();
+        // the points were packed by the caller of display, only their changes are found here
+        m_points.set_points(scene.points);
+        m_points2.set_points(scene.points2);
+        setCloudScene(scene.pose, scene.keyframe_poses, scene.frame_poses, scene.keyframe_poses2);
+    }
+}
+
+bool SolAR3DPointsViewerOpengl::useOctree(const point_cloud_buffer & points) const
+{
+    // the octree gives the order in which the points are drawn within the budget
+    if (m_pointBudget > 0 && points.size() > m_pointBudget)
+        return true;
+    return (m_levelOfDetail || m_frustumCulling) && points.size() >= OCTREE_MIN_POINTS;
+}
+
+size_t SolAR3DPointsViewerOpengl::drawPoints(point_cloud_buffer & points, point_octree & octree, const std::vector<unsigned int> & color,
+                                              const gl_view & view, size_t budget)
+{
+    glEnable(GL_POINT_SMOOTH);
+    glPointSize(m_pointSize);
+    points.use_vertex_colors(m_pointShader.use(colorOptions(color)));
+    size_t nbDrawn = points.size();
+    // the octree is only synced while the cloud is large enough, it is rebuilt when the cloud grows again
+    if (useOctree(points))
+        // without level of detail, every node in the view is drawn
+        nbDrawn = octree.draw(points, view, m_levelOfDetail ? m_lodScreenError : 0.f, budget);
+    else
+        points.draw();
+    m_pointShader.unuse();
+    return nbDrawn;
+}
+
+void SolAR3DPointsViewerOpengl::setPoses(const Transform3Df & pose,
+                                         const std::vector<Transform3Df> & keyframePoses,
+                                         const std::vector<Transform3Df> & framePoses,
+                                         const std::vector<Transform3Df> & keyframePoses2)
+{
+    m_cameraPose = pose;
+    m_keyframeInstances.set_poses(keyframePoses, m_keyframeAsCamera != 0);
+    m_keyframe2Instances.set_poses(keyframePoses2, m_keyframeAsCamera != 0);
+    if (m_trajectory)
+        m_frameTrajectory.set_poses(framePoses);
+    else
+        m_frameInstances.set_poses(framePoses, false);
+}
+
+bool SolAR3DPointsViewerOpengl::needSceneBounds(size_t nbPoints) const
+{
+    if (nbPoints == 0)
+        return false;
+    if (m_firstDisplay)
+        return !m_sceneBoundsEstimator.busy();
+    if (!m_updateSceneBounds || m_sceneBoundsEstimator.busy())
+        return false;
+    // estimate again once the number of points changed by 20%
+    return nbPoints * 5 > m_sceneBoundsNbPoints * 6 || nbPoints * 5 < m_sceneBoundsNbPoints * 4;
+}
+
+void SolAR3DPointsViewerOpengl::submitSceneBounds(scene_samples && samples, size_t nbPoints)
+{
+    // the first estimation is synchronous to have a relevant view point at the first frame
+    if (m_sceneBoundsEstimator.submit(std::move(samples), m_asyncSceneBounds && !m_firstDisplay))
+        m_sceneBoundsNbPoints = nbPoints;
+}
+
+void SolAR3DPointsViewerOpengl::updateScene()
+{
+    scene_bounds bounds;
+    if (!m_sceneBoundsEstimator.poll(bounds))
+        return;
+    // hysteresis to avoid small jumps of the scene center and gizmos size
+    if (!m_firstDisplay && !scene_bounds_changed(m_sceneBounds, bounds))
+        return;
+
+    m_sceneBounds = bounds;
+    m_sceneCenter = Point3Df(bounds.center[0], bounds.center[1], bounds.center[2]);
+    m_sceneSize = bounds.size;
+    math_vector_3f center(m_sceneCenter.getX(), m_sceneCenter.getY(), m_sceneCenter.getZ());
+    if (m_firstDisplay) {
+        // Set the camera according to the center and the size of the scene.
+        m_glcamera.resetview(center, m_sceneSize);
         m_firstDisplay = false;
     }
+    else
+        m_glcamera.set_scene(center, m_sceneSize);
+}
+
+void SolAR3DPointsViewerOpengl::requestRedraw()
+{
+    // unless the window can not be seen
+    if (m_offscreen)
+        m_redrawRequested = true;
+    else if (m_windowVisible)
+        glutPostRedisplay();
+}
+
+FrameworkReturnCode SolAR3DPointsViewerOpengl::processEvents()
+{
     if (m_exitKeyPressed)
     {
-        m_glcamera.clear(0.0, 0.0, 0.0, 1.0);
-        glutDestroyWindow(m_glWindowID);
-        glutMainLoopEvent();
+        destroyWindow();
         return FrameworkReturnCode::_STOP;
     }
 
-    glutMainLoopEvent();
+    makeCurrent();
+    if (m_offscreen) {
+        // no event loop, the scene is rendered right away
+        if (m_redrawRequested) {
+            m_redrawRequested = false;
+            OnRender();
+        }
+    }
+    else {
+        // events of the other windows may be handled too
+        glutMainLoopEvent();
+        makeCurrent();
+    }
+    // the last frames may complete while no new frame is rendered
+    collectFrame();
+    m_profiler.collect();
+    m_profiler.log_summary("3D points viewer", m_profilingPeriod);
     return FrameworkReturnCode::_SUCCESS;
 }
 
+void SolAR3DPointsViewerOpengl::collectFrame()
+{
+    if (!m_frameReadback.valid())
+        return;
+    SRef<Image> frame = m_frameReadback.fetch();
+    if (!frame)
+        return;
+    m_frameRecorder.submit(frame);
+    if (m_readback) {
+        std::lock_guard<std::mutex> lock(m_frameMutex);
+        m_lastFrame = frame;
+    }
+}
+
+SRef<Image> SolAR3DPointsViewerOpengl::readFrame()
+{
+    std::lock_guard<std::mutex> lock(m_frameMutex);
+    SRef<Image> frame;
+    frame.swap(m_lastFrame);
+    return frame;
+}
+
+unsigned int SolAR3DPointsViewerOpengl::readbackLatency() const
+{
+    return m_readback || !m_recordPath.empty() ? std::max(m_readbackBuffers, 2u) - 1 : 0;
+}
+
+frame_recorder_counters SolAR3DPointsViewerOpengl::recordCounters() const
+{
+    return m_frameRecorder.counters();
+}
+
+std::vector<stage_timing> SolAR3DPointsViewerOpengl::stageTimings() const
+{
+    return m_profiler.timings();
+}
+
 FrameworkReturnCode SolAR3DPointsViewerOpengl::display(	const SRef<PointCloud> pointCloud,
 														const Transform3Df & pose,
                                                         const std::vector<Transform3Df> & keyframePoses,
@@ -245,11 +765,12 @@ FrameworkReturnCode SolAR3DPointsViewerOpengl::display(	const SRef<PointCloud> p
 	return display(points_3Df, pose, keyframePoses, framePoses, points2_3Df, keyframePoses2);
 }
 
+// the corners are drawn as spheres with the quadric of the viewer, if not null
 void drawFrustumCamera(Transform3Df& pose,
                        std::vector<unsigned int>& color,
                        float scale,
                        float lineWidth,
-                       bool displayCorner){
+                       GLUquadric * corner){
 
     // draw  camera pose !
     std::vector<Vector4f> cameraPyramid;
@@ -264,7 +785,7 @@ void drawFrustumCamera(Transform3Df& pose,
     cameraPyramid.push_back(glpose * Vector4f(0, 0, 3.0f * scale, 1.0f));
 
     glColor3f(color[0], color[1], color[2]);
-    if (displayCorner)
+    if (corner != nullptr)
     {
         // draw a sphere at each corner of the frustum
         double cornerDiameter = 0.2f * scale;
@@ -273,7 +794,7 @@ void drawFrustumCamera(Transform3Df& pose,
         {
          glPushMatrix();
          glTranslatef(cameraPyramid[i][0], cameraPyramid[i][1], cameraPyramid[i][2]);
-         glutSolidSphere(cornerDiameter, 20, 20);
+         gluSphere(corner, cornerDiameter, 20, 20);
          glPopMatrix();
         }
     }
@@ -298,23 +819,6 @@ void drawFrustumCamera(Transform3Df& pose,
 }
 
 
-void drawSphereCamera(Transform3Df& pose,
-                      std::vector<unsigned int>& color,
-                      float diameter){
-
-    Transform3Df glPose = SolAR2GL * pose;
-    GLUquadric * point = gluNewQuadric();
-    glPushMatrix();
-    glColor3f(color[0], color[1], color[2]);
-    glTranslatef(glPose(0,3), glPose(1,3), glPose(2,3));
-    gluSphere(point, GLdouble(diameter), GLint(20), GLint(20));
-    glPopMatrix();
-
-
-    gluDeleteQuadric(point);
-
-}
-
 void drawAxis(Transform3Df& pose, float scale, float lineWidth){
 
     Transform3Df glPose = SolAR2GL * pose;
@@ -373,13 +877,43 @@ void SolAR3DPointsViewerOpengl::rotate(const float rx, const float ry, const flo
 }
 
 
+point_color_options SolAR3DPointsViewerOpengl::colorOptions(const std::vector<unsigned int> & color) const
+{
+    point_color_options options;
+    options.use_class_label = m_usePointsColorFromClassLabel > 0;
+    options.fixed_color = m_fixedPointsColor != 0;
+    for (int i = 0; i < 3; ++i)
+        options.color[i] = color[i] / 255.f;
+    return options;
+}
+
 void SolAR3DPointsViewerOpengl::OnMainLoop()
 {
 
 }
 
+bool SolAR3DPointsViewerOpengl::uploadPending() const
+{
+    return m_points.upload_pending() || m_points2.upload_pending() || m_keyframeInstances.upload_pending()
+           || m_keyframe2Instances.upload_pending() || m_frameInstances.upload_pending() || m_frameTrajectory.upload_pending();
+}
+
+void SolAR3DPointsViewerOpengl::uploadScene()
+{
+    m_points.flush();
+    m_points2.flush();
+    m_keyframeInstances.upload();
+    m_keyframe2Instances.upload();
+    m_frameInstances.upload();
+    m_frameTrajectory.upload();
+}
+
 void SolAR3DPointsViewerOpengl::OnRender()
 {
+    if (!m_windowVisible)
+        return;
+    gl_profiler::scope measureFrame(m_profiler, FRAME_STAGE);
+
     glEnable(GL_NORMALIZE);
     glEnable(GL_DEPTH_TEST);
 
@@ -408,110 +942,110 @@ void SolAR3DPointsViewerOpengl::OnRender()
         drawAxis(sceneTransform, m_sceneSize * 0.1 * m_axisScale, m_axisScale);
     }
 
-    auto fnAssignColor = [](const std::vector<SRef<datastructure::CloudPoint>>& points, const unsigned int& usePtsColorFromClassLabel, 
-    const std::vector<datastructure::Vector3f>& colorMap, const unsigned int& fixPtsColor, const std::vector<unsigned int>& ptsColor) {
-        for (unsigned int i = 0; i < points.size(); ++i) {
-            // if color map is provided, display point cloud according to class colors
-            // if cloud point does not have semantic id, display it in white color 
-            if (usePtsColorFromClassLabel>0) {
-                if (points[i]->getSemanticId() < 0) { // no semantic id associated
-                    glColor3f(1.f, 1.f, 1.f); // show in white color 
-                }
-                else if (points[i]->getSemanticId() >= static_cast<int>(colorMap.size())) {
-                    LOG_ERROR("Cloud point's semantic id {} exceeds the number of colors {}", points[i]->getSemanticId(), colorMap.size());
-                    return;
-                }
-                else {
-                    auto color = colorMap[points[i]->getSemanticId()];
-                    glColor3f(color[0]/255.f, color[1]/255.f, color[2]/255.f);
-                }
-            }
-            else { // no color map is provided
-                if (fixPtsColor)
-                    glColor3f(ptsColor[0]/255.f, ptsColor[1]/255.f, ptsColor[2]/255.f);
-                else
-                    glColor3f(points[i]->getR(), points[i]->getG(), points[i]->getB());
-            }
-
-            glVertex3f(points[i]->getX(), -points[i]->getY(), -points[i]->getZ());
-        }
-    };
+    gl_view view = gl_view::current(m_frustumCulling != 0);
+    // progressive refinement: the point budget grows at each frame while the view does not move
+    if (!view.same(m_lastView))
+        m_idleFrames = 0;
+    else if (m_pointBudgetReached)
+        ++m_idleFrames;
+    m_lastView = view;
+    size_t budget = static_cast<size_t>(m_pointBudget) * (m_idleFrames + 1);
+    size_t nbDrawn = 0;
+
+    // uploads are otherwise done by the draws, they are forced here to be measured apart
+    // a frame without anything to upload is not measured, the stage then only holds actual uploads
+    if (uploadPending()) {
+        m_profiler.begin(UPLOAD_STAGE);
+        uploadScene();
+        m_profiler.end(UPLOAD_STAGE);
+    }
 
-	if (!m_points2.empty())
-	{
-		glPushMatrix();
-		glEnable(GL_POINT_SMOOTH);
-		glPointSize(m_pointSize);
-		glBegin(GL_POINTS);
-        fnAssignColor(m_points2, m_usePointsColorFromClassLabel, m_colorMap, m_fixedPointsColor, m_points2Color);
-		glEnd();
-		glPopMatrix();
-	}
+    m_profiler.begin(POINTS_STAGE);
+    // the second cloud is drawn first, which decides the cloud visible where both overlap at equal depth,
+    // but the budget goes to the main cloud first: the second one only gets what the main one can not use
+    size_t budget2 = budget > m_points.size() ? budget - m_points.size() : 0;
+    if (!m_points2.empty() && (budget == 0 || budget2 > 0))
+        nbDrawn += drawPoints(m_points2, m_points2Octree, m_points2Color, view, budget2);
+
+    if(!m_points.empty() && (budget == 0 || nbDrawn < budget))
+        nbDrawn += drawPoints(m_points, m_pointsOctree, m_pointsColor, view, budget == 0 ? 0 : budget - nbDrawn);
+    m_pointBudgetReached = budget > 0 && nbDrawn >= budget;
+    m_profiler.end(POINTS_STAGE);
 
-    if(!m_points.empty())
+    if (!m_pointArrays.empty())
     {
-        glPushMatrix();
-        glEnable (GL_POINT_SMOOTH);
+        gl_profiler::scope measure(m_profiler, ARRAYS_STAGE);
+        glEnable(GL_POINT_SMOOTH);
         glPointSize(m_pointSize);
-        glBegin(GL_POINTS);
-        fnAssignColor(m_points, m_usePointsColorFromClassLabel, m_colorMap, m_fixedPointsColor, m_pointsColor);
-        glEnd();
-        glPopMatrix();
-    }    
+        m_pointArrays.use_vertex_colors(m_pointShader.use(colorOptions(m_pointsColor)));
+        m_pointArrays.draw();
+        m_pointShader.unuse();
+    }
 
+    m_profiler.begin(POSES_STAGE);
     // draw  camera pose !    
     std::vector<Vector4f> cameraPyramid;
-    drawFrustumCamera(m_cameraPose, m_cameraColor, 0.033f * m_cameraScale * m_sceneSize, 0.003f * m_cameraScale * m_sceneSize, true);
+    drawFrustumCamera(m_cameraPose, m_cameraColor, 0.033f * m_cameraScale * m_sceneSize, 0.003f * m_cameraScale * m_sceneSize, m_cornerQuadric);
 
     if (m_drawCameraAxis)
         drawAxis(m_cameraPose, m_sceneSize * 0.1 * m_axisScale, m_axisScale);
 
     // Draw keyframe poses
-    if (!m_keyframePoses.empty())
+    if (!m_keyframeInstances.empty())
     {
-        glPushMatrix();
+        glColor3f(m_keyframesColor[0], m_keyframesColor[1], m_keyframesColor[2]);
         if (m_keyframeAsCamera)
         {
-            for (unsigned int i = 0; i < m_keyframePoses.size(); ++i)
-                drawFrustumCamera(m_keyframePoses[i],m_keyframesColor, 0.013f * m_cameraScale * m_sceneSize,0.003f * m_cameraScale * m_sceneSize,false);
+            glLineWidth(0.003f * m_cameraScale * m_sceneSize);
+            m_poseMarkers->draw(pose_markers::FRUSTUM, m_keyframeInstances, 0.013f * m_cameraScale * m_sceneSize, view);
         }
         else
-        {
-            for (unsigned int i = 0; i < m_keyframePoses.size(); ++i)
-                drawSphereCamera(m_keyframePoses[i], m_keyframesColor, 0.005f * m_cameraScale * m_sceneSize);
-        }
-        glPopMatrix();
+            m_poseMarkers->draw(pose_markers::SPHERE, m_keyframeInstances, 0.005f * m_cameraScale * m_sceneSize, view);
     }
 
     // Draw keyframe poses for the second vector of keyframes
-    if (!m_keyframePoses2.empty())
+    if (!m_keyframe2Instances.empty())
     {
-        glPushMatrix();
+        glColor3f(m_keyframes2Color[0], m_keyframes2Color[1], m_keyframes2Color[2]);
         if (m_keyframeAsCamera)
         {
-            for (unsigned int i = 0; i < m_keyframePoses2.size(); ++i)
-                drawFrustumCamera(m_keyframePoses2[i],m_keyframes2Color, 0.013f * m_cameraScale * m_sceneSize,0.003f * m_cameraScale * m_sceneSize,false);
+            glLineWidth(0.003f * m_cameraScale * m_sceneSize);
+            m_poseMarkers->draw(pose_markers::FRUSTUM, m_keyframe2Instances, 0.013f * m_cameraScale * m_sceneSize, view);
         }
         else
-        {
-            for (unsigned int i = 0; i < m_keyframePoses2.size(); ++i)
-                drawSphereCamera(m_keyframePoses2[i], m_keyframes2Color, 0.005f * m_cameraScale * m_sceneSize);
-        }
-        glPopMatrix();
+            m_poseMarkers->draw(pose_markers::SPHERE, m_keyframe2Instances, 0.005f * m_cameraScale * m_sceneSize, view);
     }
 
     // Draw frame poses
-    if (!m_framePoses.empty())
+    if (!m_frameTrajectory.empty())
+    {
+        glColor3f(m_framesColor[0], m_framesColor[1], m_framesColor[2]);
+        glLineWidth(1.0f);
+        m_frameTrajectory.draw(m_trajectoryMarkers, TRAJECTORY_MARKER_SIZE);
+    }
+    else if (!m_frameInstances.empty())
     {
-        glPushMatrix();
-        for (unsigned int i = 0; i < m_framePoses.size(); ++i)
-            drawSphereCamera(m_framePoses[i], m_framesColor, 0.003f * m_cameraScale * m_sceneSize);
-        glPopMatrix();
+        glColor3f(m_framesColor[0], m_framesColor[1], m_framesColor[2]);
+        m_poseMarkers->draw(pose_markers::SPHERE, m_frameInstances, 0.003f * m_cameraScale * m_sceneSize, view);
     }
+    m_profiler.end(POSES_STAGE);
 
     glLineWidth(1.0f);
-    glutSwapBuffers();
-    glutPostRedisplay();
+    if (m_frameReadback.valid()) {
+        // the ring is drained before queuing the frame, so that frames are only dropped when the GPU lags behind
+        collectFrame();
+        m_frameReadback.capture(m_resolutionX, m_resolutionY);
+    }
+    m_profiler.begin(SWAP_STAGE);
+    if (m_offscreen)
+        glFlush();
+    else
+        glutSwapBuffers();
+    m_profiler.end(SWAP_STAGE);
+
+    // keep drawing while the view turns or the point cloud is refined, otherwise wait for new data or inputs
+    if (m_rotationX != 0.f || m_rotationY != 0.f || m_rotationZ != 0.f || m_pointBudgetReached)
+        requestRedraw();
 }
 
 
@@ -519,6 +1053,14 @@ void SolAR3DPointsViewerOpengl::OnResizeWindow(int _w, int _h)
 {
     m_resolutionX = _w;
     m_resolutionY = _h;
+    requestRedraw();
+}
+
+void SolAR3DPointsViewerOpengl::OnWindowStatus(int state)
+{
+    // no rendering while the window is minimized or covered
+    m_windowVisible = state != GLUT_HIDDEN && state != GLUT_FULLY_COVERED;
+    requestRedraw();
 }
 
 void SolAR3DPointsViewerOpengl::OnKeyBoard(unsigned char key, ATTRIBUTE(maybe_unused) int x, ATTRIBUTE(maybe_unused) int y)
@@ -542,6 +1084,7 @@ void SolAR3DPointsViewerOpengl::OnKeyBoard(unsigned char key, ATTRIBUTE(maybe_un
         m_rotationY = 0.0;
         m_rotationZ = 0.0;
     }
+    requestRedraw();
 }
 
 
@@ -549,6 +1092,7 @@ void SolAR3DPointsViewerOpengl::OnMouseMotion(int x, int y)
 {
     y = m_resolutionY - y;
     m_glcamera.mouse_move(x, y);
+    requestRedraw();
 }
 
 void SolAR3DPointsViewerOpengl::OnMouseState(int button, int state, int x, int y)
@@ -574,6 +1118,7 @@ void SolAR3DPointsViewerOpengl::OnMouseState(int button, int state, int x, int y
 
         m_glcamera.mouse_wheel(-m_zoomSensitivity);
     }
+    requestRedraw();
 }
 
 }
@@ -17,6 +17,8 @@
 #include "SolARSinkPoseTextureBufferOpengl.h"
 #include "core/Log.h"
 #include "xpcf/core/helpers.h"
+#include <array>
+#include <cstring>
 #include <iostream>
 namespace xpcf = org::bcom::xpcf;
 
@@ -35,11 +37,19 @@ static Transform3Df SolAR2GL = [] {
   return Transform3Df(matrix);
 }();
 
+// the channels are reordered by the upload itself, BGRA being the native texel layout of most GPUs
 static std::map<Image::ImageLayout, GLenum> SolAR2OpenGLLayout = {{Image::LAYOUT_RGB, GL_RGB},
                                                                   {Image::LAYOUT_RGBA, GL_RGBA},
                                                                   {Image::LAYOUT_RGBX, GL_RGBA},
-                                                                  {Image::LAYOUT_BGR, GL_RGB}, // GL_BGR does not exist, requires to invert B and R channel in aplication (with for example a shader)
-                                                                  {Image::LAYOUT_GREY, GL_DEPTH_COMPONENT}};
+                                                                  {Image::LAYOUT_BGR, GL_BGR},
+                                                                  {Image::LAYOUT_BGRA, GL_BGRA},
+                                                                  {Image::LAYOUT_BGRX, GL_BGRA},
+                                                                  {Image::LAYOUT_GREY, GL_RED}};
+// sampling of the texture: grey replicated to the color channels, padding channels read as opaque
+static const std::array<GLint, 4> SwizzleIdentity = {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA};
+static std::map<Image::ImageLayout, std::array<GLint, 4>> SolAR2OpenGLSwizzle = {{Image::LAYOUT_RGBX, {GL_RED, GL_GREEN, GL_BLUE, GL_ONE}},
+                                                                                {Image::LAYOUT_BGRX, {GL_RED, GL_GREEN, GL_BLUE, GL_ONE}},
+                                                                                {Image::LAYOUT_GREY, {GL_RED, GL_RED, GL_RED, GL_ONE}}};
 static std::map<Image::DataType, GLenum> SolAR2OpenGLDataType = {{Image::TYPE_8U, GL_UNSIGNED_BYTE},
                                                                  {Image::TYPE_16U, GL_UNSIGNED_SHORT},
                                                                  {Image::TYPE_32U, GL_FLOAT},
@@ -48,50 +58,118 @@ static std::map<Image::DataType, GLenum> SolAR2OpenGLDataType = {{Image::TYPE_8U
 SinkPoseTextureBuffer::SinkPoseTextureBuffer():ConfigurableBase(xpcf::toUUID<SinkPoseTextureBuffer>())
 {
    addInterface<api::sink::ISinkPoseTextureBuffer>(this);
-   m_image = nullptr;
-   m_pose = Transform3Df::Identity();
+   declareProperty("shareImages", m_shareImages);
+   declareProperty("imagePoolSize", m_imagePoolSize);
+   declareProperty("uploadBuffers", m_uploadBuffers);
+   declareProperty("profiling", m_profiling);
+   declareProperty("profilingPeriod", m_profilingPeriod);
+   m_profiler.add_stage("update", true);
    m_textureBufferSize = 0;
-   m_newPose = false;
-   m_newImage = false;
+}
+
+xpcf::XPCFErrorCode SinkPoseTextureBuffer::onConfigured()
+{
+    m_profiler.enable(m_profiling != 0);
+    m_imagePool.set_capacity(m_imagePoolSize);
+    return xpcf::XPCFErrorCode::_SUCCESS;
+}
+
+std::vector<stage_timing> SinkPoseTextureBuffer::stageTimings() const
+{
+    return m_profiler.timings();
+}
+
+image_pool_counters SinkPoseTextureBuffer::imagePoolCounters() const
+{
+    return m_imagePool.counters();
+}
+
+uint64_t SinkPoseTextureBuffer::imageSequence() const
+{
+    return m_imageSequence.load(std::memory_order_acquire);
+}
+
+uint64_t SinkPoseTextureBuffer::poseSequence() const
+{
+    return m_poseSequence.load(std::memory_order_acquire);
+}
+
+void SinkPoseTextureBuffer::release()
+{
+    m_textureUploadInitialized = false;
+    // nothing was created without the entry points
+    if (!gl::loaded())
+        return;
+    m_textureUpload.release();
+    m_profiler.release();
+}
+
+void SinkPoseTextureBuffer::publishImage(const SRef<Image> & image, uint64_t sequence)
+{
+    image_slot & slot = m_images.back();
+    if (m_shareImages)
+        slot.image = image;
+    else {
+        // the copy left in the back slot was uploaded or replaced before its upload, the render thread no longer reads it
+        // so it receives the new image, the pool is only locked when the format changes
+        if (!slot.image || !image_pool::same_format(*slot.image, *image)) {
+            m_imagePool.release(std::move(slot.image));
+            slot.image = m_imagePool.acquire(*image);
+        }
+        std::memcpy(slot.image->data(), image->data(), image->getBufferSize());
+    }
+    slot.sequence = sequence;
+    m_images.publish();
 }
 
 void SinkPoseTextureBuffer::set( const SRef<Image> image )
 {
-    m_mutex.lock();
-    m_image = image->copy();
-    m_newImage = true;
-    m_mutex.unlock();
+    publishImage(image, ++m_sequence);
 }
 
 void SinkPoseTextureBuffer::set(const Transform3Df& pose, const SRef<Image> image )
 {
-    m_mutex.lock();
-    m_pose = Transform3Df(pose);
-    m_image = image->copy();
-    m_newPose = true;
-    m_newImage = true;
-    m_mutex.unlock();
+    uint64_t sequence = ++m_sequence;
+    // the image is published first, so that it is available once the application reads its pose
+    publishImage(image, sequence);
+    pose_slot & slot = m_poses.back();
+    slot.pose = pose;
+    slot.sequence = sequence;
+    m_poses.publish();
 }
 
 FrameworkReturnCode SinkPoseTextureBuffer::setTextureBuffer(void* textureBufferHandle)
 {
-    m_mutex.lock();
-    m_textureHandle = (GLuint)(size_t)textureBufferHandle;
-    m_mutex.unlock();
+    m_textureHandle.store((GLuint)(size_t)textureBufferHandle, std::memory_order_release);
    return FrameworkReturnCode::_SUCCESS;
 }
 
 void SinkPoseTextureBuffer::updateFrameDataOGL(ATTRIBUTE(maybe_unused) int enventID)
 {
-     m_mutex.lock();
-    if (m_newImage)
+    // the context belongs to the calling application, which may not use GLUT, its entry points are resolved at the first update
+    if (!m_glResolved) {
+        m_glResolved = true;
+        if (!gl::load(gl::platform_proc_address))
+            LOG_WARNING("The OpenGL entry points of the application context can not be resolved");
+        if (m_profiler.enabled() && !gl::has_timer_queries())
+            LOG_WARNING("Without timer queries, the texture update is only timed on the CPU");
+    }
+    if (m_profiler.enabled()) {
+        m_profiler.collect();
+        m_profiler.log_summary("Texture buffer sink", m_profilingPeriod);
+    }
+    gl_profiler::scope measure(m_profiler, 0);
+    if (m_images.consume())
     {
-        m_newImage = false;
+        // the front slot belongs to the render thread until the next consume, the pipeline never waits for the upload
+        image_slot & frame = m_images.front();
+        const SRef<Image> & image = frame.image;
+        GLuint textureHandle = m_textureHandle.load(std::memory_order_acquire);
         // Update the Texture Buffer
-        glBindTexture( GL_TEXTURE_2D, m_textureHandle );
+        glBindTexture( GL_TEXTURE_2D, textureHandle );
 		GLenum error = glGetError();
 		if (error)
-			std::cout << "glBindTexture error : " << error << " for texture with handle " << m_textureHandle << std::endl;
+			std::cout << "glBindTexture error : " << error << " for texture with handle " << textureHandle << std::endl;
         glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
         glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
 
@@ -100,57 +178,72 @@ void SinkPoseTextureBuffer::updateFrameDataOGL(ATTRIBUTE(maybe_unused) int enven
         glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
 
         //use fast 4-byte alignment (default anyway) if possible
-        glPixelStorei( GL_UNPACK_ALIGNMENT, ( m_image->getStep() & 3 ) ? 1 : 4 );
+        glPixelStorei( GL_UNPACK_ALIGNMENT, ( image->getStep() & 3 ) ? 1 : 4 );
 
         //set length of one complete row in data (doesn't need to equal image.cols)
-        glPixelStorei( GL_UNPACK_ROW_LENGTH, (int)(m_image->getWidth()));
+        glPixelStorei( GL_UNPACK_ROW_LENGTH, (int)(image->getWidth()));
 
         GLenum layout, dataType;
         try{
-            layout = SolAR2OpenGLLayout.at(m_image->getImageLayout());
+            layout = SolAR2OpenGLLayout.at(image->getImageLayout());
         }
         catch  (const std::out_of_range&) {
-             LOG_WARNING("The layout of the image {} is not supported", m_image->getImageLayout());
-             m_mutex.unlock();
+             LOG_WARNING("The layout of the image {} is not supported", image->getImageLayout());
              return;
         }
 
         try{
-            dataType = SolAR2OpenGLDataType.at(m_image->getDataType());
+            dataType = SolAR2OpenGLDataType.at(image->getDataType());
         }
         catch  (const std::out_of_range&) {
-            LOG_WARNING("The data type of the image {} is not supported", m_image->getDataType());
-            m_mutex.unlock();
+            LOG_WARNING("The data type of the image {} is not supported", image->getDataType());
             return;
         }
 
-        glTexSubImage2D( GL_TEXTURE_2D,
-                         0,
-                         0,
-                         0,
-                         m_image->getWidth(),
-                         m_image->getHeight(),
-                         layout,
-                         dataType,
-                         m_image->data() );
+        if (gl::has_texture_swizzle())
+        {
+            // the texture keeps the swizzle of the last uploaded layout, so it is set for every image
+            auto swizzle = SolAR2OpenGLSwizzle.find(image->getImageLayout());
+            glTexParameteriv( GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA,
+                              swizzle != SolAR2OpenGLSwizzle.end() ? swizzle->second.data() : SwizzleIdentity.data() );
+        }
+        else if (layout == GL_RED)
+            // without swizzle masks, the luminance format replicates the grey level to the color channels at upload
+            layout = GL_LUMINANCE;
+
+        if (!m_textureUploadInitialized)
+        {
+            // pixel buffers are created in the context of the application
+            m_textureUploadInitialized = true;
+            if (!gl::loaded() || !m_textureUpload.init(m_uploadBuffers))
+                LOG_WARNING("The images are uploaded to the texture from client memory");
+        }
+        m_textureUpload.update(image->getWidth(),
+                               image->getHeight(),
+                               layout,
+                               dataType,
+                               image->data(),
+                               static_cast<size_t>(image->getStep()) * image->getHeight());
 		error = glGetError();
 		if (error)
 			std::cout << "glTexSubImage2D error : " << error << std::endl;;
+        // a copy stays in its slot, to receive a next image once back to the pipeline, a shared image is no longer referenced
+        if (m_shareImages)
+            frame.image.reset();
+        m_imageSequence.store(frame.sequence, std::memory_order_release);
     }
-    m_mutex.unlock();
 }
 
 SinkReturnCode SinkPoseTextureBuffer::udpate( Transform3Df& pose)
 {
     SinkReturnCode returnCode = SinkReturnCode::_NOTHING;
-    m_mutex.lock();
-    if (m_newPose)
+    if (m_poses.consume())
     {
-        pose = Transform3Df(m_pose);
-        m_newPose = false;
+        const pose_slot & slot = m_poses.front();
+        pose = Transform3Df(slot.pose);
+        m_poseSequence.store(slot.sequence, std::memory_order_release);
         returnCode |= SinkReturnCode::_NEW_POSE;
     }
-    m_mutex.unlock();
 
     return returnCode;
 }
@@ -159,7 +252,7 @@ SinkReturnCode SinkPoseTextureBuffer::udpate( Transform3Df& pose)
 SinkReturnCode SinkPoseTextureBuffer::tryUpdate( Transform3Df& pose)
 {
 
-    if (m_newPose || m_newImage)
+    if (m_poses.fresh() || m_images.fresh())
         return udpate(pose);
     return SinkReturnCode::_NOTHING;
 }
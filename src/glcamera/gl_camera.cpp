@@ -330,6 +330,15 @@ void gl_camera::resetview(const math_vector_3f &scene_center) {
 
 }
 
+// keep the camera where it is
+void gl_camera::set_scene(const math_vector_3f &scene_center, float scene_size) {
+
+	m_scene_center = scene_center;
+	m_scene_size = scene_size;
+	spincenter = m_camera_rm * m_scene_center;
+
+}
+
 void gl_camera::rotate( const math_matrix_3x3f & _rot ) {
 
 	math_vector_3f center = m_camera_rm * m_scene_center;
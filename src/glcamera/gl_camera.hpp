@@ -79,6 +79,8 @@ public:
 	// look at scene center
 	void resetview(const math_vector_3f &scene_center, float scene_size);
 	void resetview(const math_vector_3f &scene_center);
+	// update the scene center and size (clipping planes, spin center, motion speed) without moving the camera
+	void set_scene(const math_vector_3f &scene_center, float scene_size);
 	// rotate around scene center 180 degrees
 	void rotate_180();
 	void rotate( const math_matrix_3x3f & _rot );
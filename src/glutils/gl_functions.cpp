@@ -0,0 +1,270 @@
+#include "gl_functions.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+#ifdef SOLAR_OPENGL_USE_EGL
+#include <EGL/egl.h>
+#endif
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+namespace gl {
+
+PFNGLGENBUFFERSPROC GenBuffers = nullptr;
+PFNGLDELETEBUFFERSPROC DeleteBuffers = nullptr;
+PFNGLBINDBUFFERPROC BindBuffer = nullptr;
+PFNGLBUFFERDATAPROC BufferData = nullptr;
+PFNGLBUFFERSUBDATAPROC BufferSubData = nullptr;
+PFNGLMAPBUFFERPROC MapBuffer = nullptr;
+PFNGLUNMAPBUFFERPROC UnmapBuffer = nullptr;
+
+PFNGLCREATESHADERPROC CreateShader = nullptr;
+PFNGLDELETESHADERPROC DeleteShader = nullptr;
+PFNGLSHADERSOURCEPROC ShaderSource = nullptr;
+PFNGLCOMPILESHADERPROC CompileShader = nullptr;
+PFNGLGETSHADERIVPROC GetShaderiv = nullptr;
+PFNGLGETSHADERINFOLOGPROC GetShaderInfoLog = nullptr;
+PFNGLCREATEPROGRAMPROC CreateProgram = nullptr;
+PFNGLDELETEPROGRAMPROC DeleteProgram = nullptr;
+PFNGLATTACHSHADERPROC AttachShader = nullptr;
+PFNGLBINDATTRIBLOCATIONPROC BindAttribLocation = nullptr;
+PFNGLLINKPROGRAMPROC LinkProgram = nullptr;
+PFNGLGETPROGRAMIVPROC GetProgramiv = nullptr;
+PFNGLGETPROGRAMINFOLOGPROC GetProgramInfoLog = nullptr;
+PFNGLUSEPROGRAMPROC UseProgram = nullptr;
+PFNGLGETUNIFORMLOCATIONPROC GetUniformLocation = nullptr;
+PFNGLUNIFORM1IPROC Uniform1i = nullptr;
+PFNGLUNIFORM1FPROC Uniform1f = nullptr;
+PFNGLUNIFORM3FPROC Uniform3f = nullptr;
+PFNGLENABLEVERTEXATTRIBARRAYPROC EnableVertexAttribArray = nullptr;
+PFNGLDISABLEVERTEXATTRIBARRAYPROC DisableVertexAttribArray = nullptr;
+PFNGLVERTEXATTRIBPOINTERPROC VertexAttribPointer = nullptr;
+PFNGLVERTEXATTRIB1FPROC VertexAttrib1f = nullptr;
+
+PFNGLVERTEXATTRIBDIVISORPROC VertexAttribDivisor = nullptr;
+PFNGLDRAWARRAYSINSTANCEDPROC DrawArraysInstanced = nullptr;
+
+PFNGLGENFRAMEBUFFERSPROC GenFramebuffers = nullptr;
+PFNGLDELETEFRAMEBUFFERSPROC DeleteFramebuffers = nullptr;
+PFNGLBINDFRAMEBUFFERPROC BindFramebuffer = nullptr;
+PFNGLFRAMEBUFFERRENDERBUFFERPROC FramebufferRenderbuffer = nullptr;
+PFNGLCHECKFRAMEBUFFERSTATUSPROC CheckFramebufferStatus = nullptr;
+PFNGLGENRENDERBUFFERSPROC GenRenderbuffers = nullptr;
+PFNGLDELETERENDERBUFFERSPROC DeleteRenderbuffers = nullptr;
+PFNGLBINDRENDERBUFFERPROC BindRenderbuffer = nullptr;
+PFNGLRENDERBUFFERSTORAGEPROC RenderbufferStorage = nullptr;
+PFNGLBLITFRAMEBUFFERPROC BlitFramebuffer = nullptr;
+
+PFNGLFENCESYNCPROC FenceSync = nullptr;
+PFNGLCLIENTWAITSYNCPROC ClientWaitSync = nullptr;
+PFNGLDELETESYNCPROC DeleteSync = nullptr;
+
+PFNGLGENQUERIESPROC GenQueries = nullptr;
+PFNGLDELETEQUERIESPROC DeleteQueries = nullptr;
+PFNGLBEGINQUERYPROC BeginQuery = nullptr;
+PFNGLENDQUERYPROC EndQuery = nullptr;
+PFNGLGETQUERYOBJECTIVPROC GetQueryObjectiv = nullptr;
+PFNGLGETQUERYOBJECTUI64VPROC GetQueryObjectui64v = nullptr;
+
+static bool s_loaded = false;
+static bool s_shaders = false;
+static bool s_instancing = false;
+static bool s_framebuffers = false;
+static bool s_sync = false;
+static bool s_pixel_buffers = false;
+static bool s_timer_queries = false;
+static bool s_texture_swizzle = false;
+
+template <typename T>
+static bool resolve(proc_loader loader, T & function, const char * name)
+{
+    function = reinterpret_cast<T>(loader(name));
+    return function != nullptr;
+}
+
+// core name first, then extension name
+template <typename T>
+static bool resolve(proc_loader loader, T & function, const char * name, const char * extensionName)
+{
+    return resolve(loader, function, name) || resolve(loader, function, extensionName);
+}
+
+bool version_at_least(int major, int minor)
+{
+    const char * version = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+    int contextMajor = 0, contextMinor = 0;
+    if (version == nullptr || std::sscanf(version, "%d.%d", &contextMajor, &contextMinor) != 2)
+        return false;
+    return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+}
+
+bool has_extension(const char * name)
+{
+    const char * extensions = reinterpret_cast<const char *>(glGetString(GL_EXTENSIONS));
+    if (extensions == nullptr)
+        return false;
+    size_t length = std::strlen(name);
+    for (const char * found = std::strstr(extensions, name); found != nullptr; found = std::strstr(found + length, name)) {
+        // whole word only
+        if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0'))
+            return true;
+    }
+    return false;
+}
+
+bool load(proc_loader loader)
+{
+    if (s_loaded)
+        return true;
+
+    bool success = true;
+    success &= resolve(loader, GenBuffers, "glGenBuffers");
+    success &= resolve(loader, DeleteBuffers, "glDeleteBuffers");
+    success &= resolve(loader, BindBuffer, "glBindBuffer");
+    success &= resolve(loader, BufferData, "glBufferData");
+    success &= resolve(loader, BufferSubData, "glBufferSubData");
+    success &= resolve(loader, MapBuffer, "glMapBuffer");
+    success &= resolve(loader, UnmapBuffer, "glUnmapBuffer");
+
+    // some loaders return a stub for any name, so optional features also depend on the context version
+    s_shaders = version_at_least(2, 0);
+    s_shaders &= resolve(loader, CreateShader, "glCreateShader");
+    s_shaders &= resolve(loader, DeleteShader, "glDeleteShader");
+    s_shaders &= resolve(loader, ShaderSource, "glShaderSource");
+    s_shaders &= resolve(loader, CompileShader, "glCompileShader");
+    s_shaders &= resolve(loader, GetShaderiv, "glGetShaderiv");
+    s_shaders &= resolve(loader, GetShaderInfoLog, "glGetShaderInfoLog");
+    s_shaders &= resolve(loader, CreateProgram, "glCreateProgram");
+    s_shaders &= resolve(loader, DeleteProgram, "glDeleteProgram");
+    s_shaders &= resolve(loader, AttachShader, "glAttachShader");
+    s_shaders &= resolve(loader, BindAttribLocation, "glBindAttribLocation");
+    s_shaders &= resolve(loader, LinkProgram, "glLinkProgram");
+    s_shaders &= resolve(loader, GetProgramiv, "glGetProgramiv");
+    s_shaders &= resolve(loader, GetProgramInfoLog, "glGetProgramInfoLog");
+    s_shaders &= resolve(loader, UseProgram, "glUseProgram");
+    s_shaders &= resolve(loader, GetUniformLocation, "glGetUniformLocation");
+    s_shaders &= resolve(loader, Uniform1i, "glUniform1i");
+    s_shaders &= resolve(loader, Uniform1f, "glUniform1f");
+    s_shaders &= resolve(loader, Uniform3f, "glUniform3f");
+    s_shaders &= resolve(loader, EnableVertexAttribArray, "glEnableVertexAttribArray");
+    s_shaders &= resolve(loader, DisableVertexAttribArray, "glDisableVertexAttribArray");
+    s_shaders &= resolve(loader, VertexAttribPointer, "glVertexAttribPointer");
+    s_shaders &= resolve(loader, VertexAttrib1f, "glVertexAttrib1f");
+
+    s_instancing = s_shaders && (version_at_least(3, 3) || has_extension("GL_ARB_instanced_arrays"));
+    s_instancing &= resolve(loader, VertexAttribDivisor, "glVertexAttribDivisor", "glVertexAttribDivisorARB");
+    s_instancing &= resolve(loader, DrawArraysInstanced, "glDrawArraysInstanced", "glDrawArraysInstancedARB");
+
+    s_framebuffers = version_at_least(3, 0) || has_extension("GL_ARB_framebuffer_object");
+    s_framebuffers &= resolve(loader, GenFramebuffers, "glGenFramebuffers");
+    s_framebuffers &= resolve(loader, DeleteFramebuffers, "glDeleteFramebuffers");
+    s_framebuffers &= resolve(loader, BindFramebuffer, "glBindFramebuffer");
+    s_framebuffers &= resolve(loader, FramebufferRenderbuffer, "glFramebufferRenderbuffer");
+    s_framebuffers &= resolve(loader, CheckFramebufferStatus, "glCheckFramebufferStatus");
+    s_framebuffers &= resolve(loader, GenRenderbuffers, "glGenRenderbuffers");
+    s_framebuffers &= resolve(loader, DeleteRenderbuffers, "glDeleteRenderbuffers");
+    s_framebuffers &= resolve(loader, BindRenderbuffer, "glBindRenderbuffer");
+    s_framebuffers &= resolve(loader, RenderbufferStorage, "glRenderbufferStorage");
+    s_framebuffers &= resolve(loader, BlitFramebuffer, "glBlitFramebuffer");
+
+    s_sync = version_at_least(3, 2) || has_extension("GL_ARB_sync");
+    s_sync &= resolve(loader, FenceSync, "glFenceSync");
+    s_sync &= resolve(loader, ClientWaitSync, "glClientWaitSync");
+    s_sync &= resolve(loader, DeleteSync, "glDeleteSync");
+
+    s_timer_queries = version_at_least(3, 3) || has_extension("GL_ARB_timer_query");
+    s_timer_queries &= resolve(loader, GenQueries, "glGenQueries");
+    s_timer_queries &= resolve(loader, DeleteQueries, "glDeleteQueries");
+    s_timer_queries &= resolve(loader, BeginQuery, "glBeginQuery");
+    s_timer_queries &= resolve(loader, EndQuery, "glEndQuery");
+    s_timer_queries &= resolve(loader, GetQueryObjectiv, "glGetQueryObjectiv");
+    s_timer_queries &= resolve(loader, GetQueryObjectui64v, "glGetQueryObjectui64v");
+
+    s_pixel_buffers = version_at_least(2, 1) || has_extension("GL_ARB_pixel_buffer_object");
+
+    s_texture_swizzle = version_at_least(3, 3) || has_extension("GL_ARB_texture_swizzle") || has_extension("GL_EXT_texture_swizzle");
+
+    // without the mandatory entry points, no feature is used (e.g. the profilers only measure on the CPU)
+    if (!success)
+        s_shaders = s_instancing = s_framebuffers = s_sync = s_timer_queries = s_pixel_buffers = s_texture_swizzle = false;
+    s_loaded = success;
+    return success;
+}
+
+proc platform_proc_address(const char * name)
+{
+#if defined(_WIN32)
+    // wglGetProcAddress does not return the OpenGL 1.1 entry points, and some drivers return small values instead of null
+    PROC function = wglGetProcAddress(name);
+    intptr_t value = reinterpret_cast<intptr_t>(function);
+    if (value == 0 || value == 1 || value == 2 || value == 3 || value == -1)
+        function = GetProcAddress(GetModuleHandleA("opengl32.dll"), name);
+    return reinterpret_cast<proc>(function);
+#elif defined(__APPLE__)
+    // the OpenGL framework exports every entry point
+    return reinterpret_cast<proc>(dlsym(RTLD_DEFAULT, name));
+#else
+#ifdef SOLAR_OPENGL_USE_EGL
+    if (eglGetCurrentContext() != EGL_NO_CONTEXT)
+        return reinterpret_cast<proc>(eglGetProcAddress(name));
+#endif
+    // GLX is resolved from the OpenGL library already loaded by GLUT, so the module does not link to it
+    typedef proc (*glx_proc_loader)(const GLubyte * name);
+    static glx_proc_loader glxGetProcAddress = reinterpret_cast<glx_proc_loader>(dlsym(RTLD_DEFAULT, "glXGetProcAddressARB"));
+    if (glxGetProcAddress != nullptr)
+        return glxGetProcAddress(reinterpret_cast<const GLubyte *>(name));
+    return reinterpret_cast<proc>(dlsym(RTLD_DEFAULT, name));
+#endif
+}
+
+bool loaded()
+{
+    return s_loaded;
+}
+
+bool has_shaders()
+{
+    return s_shaders;
+}
+
+bool has_instancing()
+{
+    return s_instancing;
+}
+
+bool has_framebuffers()
+{
+    return s_framebuffers;
+}
+
+bool has_sync()
+{
+    return s_sync;
+}
+
+bool has_timer_queries()
+{
+    return s_timer_queries;
+}
+
+bool has_pixel_buffers()
+{
+    return s_pixel_buffers;
+}
+
+bool has_texture_swizzle()
+{
+    return s_texture_swizzle;
+}
+
+}
+}
+}
+}
@@ -0,0 +1,122 @@
+#ifndef _GL_FUNCTIONS_H
+#define _GL_FUNCTIONS_H
+
+#ifdef __APPLE__
+#include "GL/freeglut.h"
+#else
+#include "freeglut.h"
+#endif
+#ifdef _WIN32
+#include <GL/glext.h>
+#endif
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+/**
+ * OpenGL entry points above version 1.1 are not exported by every platform library (opengl32.dll only
+ * provides OpenGL 1.1), so they are resolved at runtime once a context is current.
+ */
+namespace gl {
+
+typedef void (*proc)();
+typedef proc (*proc_loader)(const char *name);
+
+// vertex buffer objects (OpenGL 1.5)
+extern PFNGLGENBUFFERSPROC GenBuffers;
+extern PFNGLDELETEBUFFERSPROC DeleteBuffers;
+extern PFNGLBINDBUFFERPROC BindBuffer;
+extern PFNGLBUFFERDATAPROC BufferData;
+extern PFNGLBUFFERSUBDATAPROC BufferSubData;
+extern PFNGLMAPBUFFERPROC MapBuffer;
+extern PFNGLUNMAPBUFFERPROC UnmapBuffer;
+
+// shaders (OpenGL 2.0), optional
+extern PFNGLCREATESHADERPROC CreateShader;
+extern PFNGLDELETESHADERPROC DeleteShader;
+extern PFNGLSHADERSOURCEPROC ShaderSource;
+extern PFNGLCOMPILESHADERPROC CompileShader;
+extern PFNGLGETSHADERIVPROC GetShaderiv;
+extern PFNGLGETSHADERINFOLOGPROC GetShaderInfoLog;
+extern PFNGLCREATEPROGRAMPROC CreateProgram;
+extern PFNGLDELETEPROGRAMPROC DeleteProgram;
+extern PFNGLATTACHSHADERPROC AttachShader;
+extern PFNGLBINDATTRIBLOCATIONPROC BindAttribLocation;
+extern PFNGLLINKPROGRAMPROC LinkProgram;
+extern PFNGLGETPROGRAMIVPROC GetProgramiv;
+extern PFNGLGETPROGRAMINFOLOGPROC GetProgramInfoLog;
+extern PFNGLUSEPROGRAMPROC UseProgram;
+extern PFNGLGETUNIFORMLOCATIONPROC GetUniformLocation;
+extern PFNGLUNIFORM1IPROC Uniform1i;
+extern PFNGLUNIFORM1FPROC Uniform1f;
+extern PFNGLUNIFORM3FPROC Uniform3f;
+extern PFNGLENABLEVERTEXATTRIBARRAYPROC EnableVertexAttribArray;
+extern PFNGLDISABLEVERTEXATTRIBARRAYPROC DisableVertexAttribArray;
+extern PFNGLVERTEXATTRIBPOINTERPROC VertexAttribPointer;
+extern PFNGLVERTEXATTRIB1FPROC VertexAttrib1f;
+
+// instanced arrays (OpenGL 3.3 or ARB_instanced_arrays), optional
+extern PFNGLVERTEXATTRIBDIVISORPROC VertexAttribDivisor;
+extern PFNGLDRAWARRAYSINSTANCEDPROC DrawArraysInstanced;
+
+// framebuffer objects (OpenGL 3.0 or ARB_framebuffer_object), optional
+extern PFNGLGENFRAMEBUFFERSPROC GenFramebuffers;
+extern PFNGLDELETEFRAMEBUFFERSPROC DeleteFramebuffers;
+extern PFNGLBINDFRAMEBUFFERPROC BindFramebuffer;
+extern PFNGLFRAMEBUFFERRENDERBUFFERPROC FramebufferRenderbuffer;
+extern PFNGLCHECKFRAMEBUFFERSTATUSPROC CheckFramebufferStatus;
+extern PFNGLGENRENDERBUFFERSPROC GenRenderbuffers;
+extern PFNGLDELETERENDERBUFFERSPROC DeleteRenderbuffers;
+extern PFNGLBINDRENDERBUFFERPROC BindRenderbuffer;
+extern PFNGLRENDERBUFFERSTORAGEPROC RenderbufferStorage;
+extern PFNGLBLITFRAMEBUFFERPROC BlitFramebuffer;
+
+// sync objects (OpenGL 3.2 or ARB_sync), optional
+extern PFNGLFENCESYNCPROC FenceSync;
+extern PFNGLCLIENTWAITSYNCPROC ClientWaitSync;
+extern PFNGLDELETESYNCPROC DeleteSync;
+
+// timer queries (OpenGL 3.3 or ARB_timer_query), optional
+extern PFNGLGENQUERIESPROC GenQueries;
+extern PFNGLDELETEQUERIESPROC DeleteQueries;
+extern PFNGLBEGINQUERYPROC BeginQuery;
+extern PFNGLENDQUERYPROC EndQuery;
+extern PFNGLGETQUERYOBJECTIVPROC GetQueryObjectiv;
+extern PFNGLGETQUERYOBJECTUI64VPROC GetQueryObjectui64v;
+
+// resolve all entry points with the given loader (e.g. glutGetProcAddress), a context must be current
+// returns false if a mandatory entry point is missing, every optional feature is then unavailable
+bool load(proc_loader loader);
+
+// loader of the platform (EGL or GLX, WGL, or the OpenGL framework), for contexts created by an application
+// that does not initialize GLUT, whose glutGetProcAddress would terminate the process
+proc platform_proc_address(const char * name);
+
+// true once load() succeeded
+bool loaded();
+
+// true if the optional entry points of a feature are available
+bool has_shaders();
+bool has_instancing();
+bool has_framebuffers();
+bool has_sync();
+bool has_timer_queries();
+
+// pixel buffer objects (OpenGL 2.1 or ARB_pixel_buffer_object) only need the vertex buffer entry points
+bool has_pixel_buffers();
+
+// texture swizzle masks (OpenGL 3.3 or ARB/EXT_texture_swizzle) only need glTexParameteriv
+bool has_texture_swizzle();
+
+// version and extensions of the current context
+bool version_at_least(int major, int minor);
+bool has_extension(const char * name);
+
+}
+
+}
+}
+}
+
+#endif
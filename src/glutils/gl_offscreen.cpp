@@ -0,0 +1,201 @@
+#include "gl_offscreen.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#ifdef SOLAR_OPENGL_USE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include "core/Log.h"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+#ifdef SOLAR_OPENGL_USE_EGL
+
+static bool has_egl_extension(EGLDisplay display, const char * name)
+{
+    const char * extensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (extensions == nullptr)
+        return false;
+    size_t length = std::strlen(name);
+    for (const char * found = std::strstr(extensions, name); found != nullptr; found = std::strstr(found + length, name)) {
+        if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0'))
+            return true;
+    }
+    return false;
+}
+
+// live contexts of the process, new contexts share the objects of the first one
+// the lock also covers the initialization and the termination of the display, shared by all the contexts
+static std::recursive_mutex s_contextsMutex;
+static std::vector<EGLContext> s_contexts;
+
+static gl::proc load_egl(const char * name)
+{
+    return reinterpret_cast<gl::proc>(eglGetProcAddress(name));
+}
+
+static EGLDisplay surfaceless_display()
+{
+    // client extensions are queried without display
+    if (has_egl_extension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless")) {
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay != nullptr) {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY)
+                return display;
+        }
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+bool gl_offscreen::create(int width, int height)
+{
+    if (width <= 0 || height <= 0) {
+        LOG_ERROR("Offscreen rendering needs a width and a height, got {}x{}", width, height);
+        return false;
+    }
+
+    std::unique_lock<std::recursive_mutex> lock(s_contextsMutex);
+    EGLDisplay display = surfaceless_display();
+    EGLint major = 0, minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        LOG_ERROR("Failed to initialize an EGL display for offscreen rendering (error {:#x})", eglGetError());
+        return false;
+    }
+    m_display = display;
+    if (!has_egl_extension(display, "EGL_KHR_surfaceless_context")) {
+        LOG_ERROR("EGL {}.{} does not support contexts without surface", major, minor);
+        release();
+        return false;
+    }
+    eglBindAPI(EGL_OPENGL_API);
+
+    const EGLint configAttributes[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    EGLConfig config = nullptr;
+    EGLint nbConfigs = 0;
+    eglChooseConfig(display, configAttributes, &config, 1, &nbConfigs);
+    if (nbConfigs == 0 && !has_egl_extension(display, "EGL_KHR_no_config_context")) {
+        LOG_ERROR("No EGL configuration for desktop OpenGL");
+        release();
+        return false;
+    }
+    EGLContext shared = s_contexts.empty() ? EGL_NO_CONTEXT : s_contexts.front();
+    EGLContext context = eglCreateContext(display, nbConfigs > 0 ? config : EGLConfig(nullptr), shared, nullptr);
+    if (context != EGL_NO_CONTEXT)
+        s_contexts.push_back(context);
+    m_context = context;
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        LOG_ERROR("Failed to create an offscreen OpenGL context (error {:#x})", eglGetError());
+        release();
+        return false;
+    }
+    lock.unlock();
+
+    if (!gl::load(load_egl) || !gl::has_framebuffers()) {
+        LOG_ERROR("OpenGL 1.5 vertex buffer objects and framebuffer objects are required for offscreen rendering");
+        release();
+        return false;
+    }
+    gl::GenFramebuffers(1, &m_framebuffer);
+    gl::GenRenderbuffers(1, &m_color);
+    gl::GenRenderbuffers(1, &m_depth);
+    gl::BindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    gl::BindRenderbuffer(GL_RENDERBUFFER, m_color);
+    gl::RenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    gl::FramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_color);
+    gl::BindRenderbuffer(GL_RENDERBUFFER, m_depth);
+    gl::RenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    gl::FramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depth);
+    gl::BindRenderbuffer(GL_RENDERBUFFER, 0);
+    if (gl::CheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        LOG_ERROR("Incomplete framebuffer of {}x{} for offscreen rendering", width, height);
+        release();
+        return false;
+    }
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    // without surface, the initial viewport is empty
+    glViewport(0, 0, width, height);
+    m_width = width;
+    m_height = height;
+    LOG_INFO("Offscreen rendering with {} {}", reinterpret_cast<const char *>(glGetString(GL_RENDERER)),
+             reinterpret_cast<const char *>(glGetString(GL_VERSION)));
+    return true;
+}
+
+bool gl_offscreen::make_current()
+{
+    if (m_context == nullptr)
+        return false;
+    if (eglGetCurrentContext() == m_context)
+        return true;
+    if (!eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context))
+        return false;
+    // framebuffer objects are not shared
+    gl::BindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    return true;
+}
+
+void gl_offscreen::release()
+{
+    if (m_context != nullptr) {
+        // framebuffer objects are not shared, they are deleted in this context rather than in the current one
+        EGLDisplay previousDisplay = eglGetCurrentDisplay();
+        EGLContext previousContext = eglGetCurrentContext();
+        EGLSurface previousDraw = eglGetCurrentSurface(EGL_DRAW);
+        EGLSurface previousRead = eglGetCurrentSurface(EGL_READ);
+        if (m_framebuffer != 0 && eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context)) {
+            gl::BindFramebuffer(GL_FRAMEBUFFER, 0);
+            gl::DeleteFramebuffers(1, &m_framebuffer);
+            gl::DeleteRenderbuffers(1, &m_color);
+            gl::DeleteRenderbuffers(1, &m_depth);
+        }
+        // the context of another viewer stays current
+        if (previousContext != EGL_NO_CONTEXT && previousContext != m_context)
+            eglMakeCurrent(previousDisplay, previousDraw, previousRead, previousContext);
+        else
+            eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    }
+    std::lock_guard<std::recursive_mutex> lock(s_contextsMutex);
+    if (m_context != nullptr) {
+        eglDestroyContext(m_display, m_context);
+        s_contexts.erase(std::remove(s_contexts.begin(), s_contexts.end(), m_context), s_contexts.end());
+    }
+    // the display is shared by the contexts of the process, it is terminated with the last one
+    if (m_display != nullptr && s_contexts.empty())
+        eglTerminate(m_display);
+    m_framebuffer = m_color = m_depth = 0;
+    m_context = nullptr;
+    m_display = nullptr;
+    m_width = m_height = 0;
+}
+
+#else
+
+bool gl_offscreen::create(int, int)
+{
+    LOG_ERROR("Offscreen rendering is not available, the module is built without EGL");
+    return false;
+}
+
+void gl_offscreen::release()
+{
+}
+
+bool gl_offscreen::make_current()
+{
+    return false;
+}
+
+#endif
+
+}
+}
+}
@@ -0,0 +1,50 @@
+#ifndef _GL_OFFSCREEN_H
+#define _GL_OFFSCREEN_H
+
+#include "gl_functions.hpp"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+// OpenGL context without window system, rendering into a framebuffer object
+// The context is created on an EGL surfaceless display (e.g. Mesa, also with its software rasterizer), so it
+// does not need any X or Wayland server. Only available when the module is built with SOLAR_OPENGL_USE_EGL.
+// All the offscreen contexts of the process share their objects (buffers, textures, programs).
+class gl_offscreen {
+public:
+    gl_offscreen() = default;
+    gl_offscreen(const gl_offscreen &) = delete;
+    gl_offscreen & operator=(const gl_offscreen &) = delete;
+    ~gl_offscreen() { release(); }
+
+    // create the context, make it current on the calling thread, load the OpenGL entry points,
+    // and create and bind a framebuffer of the given size with color and depth buffers
+    // returns false and logs the reason on failure
+    bool create(int width, int height);
+
+    // free the framebuffer and the context, the context current on the calling thread before the call stays current
+    void release();
+
+    // make the context current on the calling thread, with its framebuffer bound
+    bool make_current();
+
+    bool valid() const { return m_context != nullptr; }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+private:
+    void * m_display = nullptr;                           // EGLDisplay
+    void * m_context = nullptr;                           // EGLContext
+    GLuint m_framebuffer = 0;
+    GLuint m_color = 0;
+    GLuint m_depth = 0;
+    int m_width = 0;
+    int m_height = 0;
+};
+
+}
+}
+}
+
+#endif
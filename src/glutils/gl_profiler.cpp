@@ -0,0 +1,159 @@
+#include "gl_profiler.hpp"
+
+#include <algorithm>
+
+#include "core/Log.h"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+void gl_profiler::samples::add(float value)
+{
+    if (values.size() < WINDOW)
+        values.push_back(value);
+    else
+        values[count % WINDOW] = value;
+    ++count;
+}
+
+void gl_profiler::samples::percentiles(float & p50, float & p95, float & p99) const
+{
+    if (values.empty())
+        return;
+    std::vector<float> sorted(values);
+    std::sort(sorted.begin(), sorted.end());
+    auto at = [&sorted](float p) { return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))]; };
+    p50 = at(0.50f);
+    p95 = at(0.95f);
+    p99 = at(0.99f);
+}
+
+size_t gl_profiler::add_stage(const std::string & name, bool gpu)
+{
+    m_stages.emplace_back();
+    m_stages.back().name = name;
+    m_stages.back().gpu = gpu;
+    return m_stages.size() - 1;
+}
+
+void gl_profiler::begin(size_t index)
+{
+    if (!m_enabled)
+        return;
+    stage & s = m_stages[index];
+    s.gpu_started = s.gpu && !m_gpu_busy && gl::has_timer_queries();
+    if (s.gpu_started) {
+        GLuint query = 0;
+        if (m_free_queries.empty())
+            gl::GenQueries(1, &query);
+        else {
+            query = m_free_queries.back();
+            m_free_queries.pop_back();
+        }
+        gl::BeginQuery(GL_TIME_ELAPSED, query);
+        s.pending.push_back(query);
+        m_gpu_busy = true;
+    }
+    s.start = std::chrono::steady_clock::now();
+}
+
+void gl_profiler::end(size_t index)
+{
+    if (!m_enabled)
+        return;
+    stage & s = m_stages[index];
+    float duration = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - s.start).count();
+    if (s.gpu_started) {
+        gl::EndQuery(GL_TIME_ELAPSED);
+        s.gpu_started = false;
+        m_gpu_busy = false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    s.cpu.add(duration);
+}
+
+void gl_profiler::collect()
+{
+    if (!m_enabled || !gl::has_timer_queries())
+        return;
+    for (stage & s : m_stages) {
+        // CPU stages may be measured by another thread, e.g. the caller of a viewer with a render thread
+        if (!s.gpu)
+            continue;
+        // the query of a running measure is not complete
+        size_t nbEnded = s.pending.size() - (s.gpu_started ? 1 : 0);
+        for (size_t i = 0; i < nbEnded; ++i) {
+            GLuint query = s.pending.front();
+            GLint available = 0;
+            gl::GetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+            GLuint64 nanoseconds = 0;
+            gl::GetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+            s.pending.pop_front();
+            m_free_queries.push_back(query);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            s.gpu_samples.add(static_cast<float>(nanoseconds * 1e-6));
+        }
+    }
+}
+
+std::vector<stage_timing> gl_profiler::timings() const
+{
+    std::vector<stage_timing> timings;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const stage & s : m_stages) {
+        stage_timing timing;
+        timing.name = s.name;
+        timing.cpu_count = s.cpu.count;
+        s.cpu.percentiles(timing.cpu_p50, timing.cpu_p95, timing.cpu_p99);
+        timing.gpu_count = s.gpu_samples.count;
+        s.gpu_samples.percentiles(timing.gpu_p50, timing.gpu_p95, timing.gpu_p99);
+        timings.push_back(timing);
+    }
+    return timings;
+}
+
+void gl_profiler::log_summary(const std::string & title, float period)
+{
+    if (!m_enabled || period <= 0.f)
+        return;
+    auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration<float>(now - m_last_summary).count() < period)
+        return;
+    m_last_summary = now;
+    LOG_INFO("{} timings in ms (p50 / p95 / p99 of the last {} measures)", title, WINDOW);
+    for (const stage_timing & timing : timings()) {
+        if (timing.cpu_count == 0)
+            continue;
+        // the log macros are not single statements
+        if (timing.gpu_count > 0) {
+            LOG_INFO("  {}: cpu {:.3f} / {:.3f} / {:.3f}, gpu {:.3f} / {:.3f} / {:.3f}, {} measures", timing.name,
+                     timing.cpu_p50, timing.cpu_p95, timing.cpu_p99, timing.gpu_p50, timing.gpu_p95, timing.gpu_p99, timing.cpu_count);
+        }
+        else
+            LOG_INFO("  {}: cpu {:.3f} / {:.3f} / {:.3f}, {} measures", timing.name,
+                     timing.cpu_p50, timing.cpu_p95, timing.cpu_p99, timing.cpu_count);
+    }
+}
+
+void gl_profiler::release()
+{
+    if (!gl::has_timer_queries())
+        return;
+    for (stage & s : m_stages) {
+        for (GLuint query : s.pending)
+            gl::DeleteQueries(1, &query);
+        s.pending.clear();
+        s.gpu_started = false;
+    }
+    if (!m_free_queries.empty())
+        gl::DeleteQueries(static_cast<GLsizei>(m_free_queries.size()), m_free_queries.data());
+    m_free_queries.clear();
+    m_gpu_busy = false;
+}
+
+}
+}
+}
@@ -0,0 +1,104 @@
+#ifndef _GL_PROFILER_H
+#define _GL_PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "gl_functions.hpp"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+// percentiles in milliseconds of the last durations of a stage, on the CPU and on the GPU
+struct stage_timing {
+    std::string name;
+    uint64_t cpu_count = 0;                               // number of measures since the start
+    float cpu_p50 = 0.f, cpu_p95 = 0.f, cpu_p99 = 0.f;
+    uint64_t gpu_count = 0;                               // 0 if the stage is not measured on the GPU
+    float gpu_p50 = 0.f, gpu_p95 = 0.f, gpu_p99 = 0.f;
+};
+
+// Measures the duration of named stages with the steady clock, and on the GPU with GL_TIME_ELAPSED queries
+// GPU results are collected without waiting, frames after the measure. Time elapsed queries can not be nested, so
+// a GPU stage started while another one is measured is only measured on the CPU.
+class gl_profiler {
+public:
+    // number of last measures of a stage from which the percentiles are computed
+    static constexpr size_t WINDOW = 1024;
+
+    gl_profiler() = default;
+    gl_profiler(const gl_profiler &) = delete;
+    gl_profiler & operator=(const gl_profiler &) = delete;
+
+    // a disabled profiler does not measure anything
+    void enable(bool enabled) { m_enabled = enabled; }
+    bool enabled() const { return m_enabled; }
+
+    // declare a stage before any measure, returns its index
+    size_t add_stage(const std::string & name, bool gpu);
+
+    // start and stop the measure of a stage, a context must be current for a GPU stage
+    // a stage is measured by a single thread at a time, a CPU stage may be measured by another thread than the context one
+    void begin(size_t stage);
+    void end(size_t stage);
+
+    // read the results of the completed GPU queries, a context must be current
+    void collect();
+
+    std::vector<stage_timing> timings() const;
+
+    // log the timings of every stage if period seconds passed since the last summary (never if period <= 0)
+    void log_summary(const std::string & title, float period);
+
+    // free the queries, a context must be current
+    void release();
+
+    // measure of a stage for the lifetime of the scope
+    class scope {
+    public:
+        scope(gl_profiler & profiler, size_t stage) : m_profiler(profiler), m_stage(stage) { m_profiler.begin(m_stage); }
+        ~scope() { m_profiler.end(m_stage); }
+        scope(const scope &) = delete;
+        scope & operator=(const scope &) = delete;
+    private:
+        gl_profiler & m_profiler;
+        size_t m_stage;
+    };
+
+private:
+    // last durations in milliseconds, as a ring
+    struct samples {
+        std::vector<float> values;
+        uint64_t count = 0;
+        void add(float value);
+        void percentiles(float & p50, float & p95, float & p99) const;
+    };
+
+    struct stage {
+        std::string name;
+        bool gpu = false;
+        std::chrono::steady_clock::time_point start;
+        bool gpu_started = false;
+        std::deque<GLuint> pending;                       // queries waiting for their result, in order
+        samples cpu;
+        samples gpu_samples;
+    };
+
+    bool m_enabled = false;
+    std::vector<stage> m_stages;
+    std::vector<GLuint> m_free_queries;
+    bool m_gpu_busy = false;                              // a time elapsed query is active
+    mutable std::mutex m_mutex;                           // guards the samples
+    std::chrono::steady_clock::time_point m_last_summary = std::chrono::steady_clock::now();
+};
+
+}
+}
+}
+
+#endif
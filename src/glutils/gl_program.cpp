@@ -0,0 +1,77 @@
+#include "gl_program.hpp"
+
+#include <string>
+
+#include "core/Log.h"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+static GLuint compile(GLenum type, const char * source)
+{
+    GLuint shader = gl::CreateShader(type);
+    gl::ShaderSource(shader, 1, &source, nullptr);
+    gl::CompileShader(shader);
+    GLint status = GL_FALSE;
+    gl::GetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        GLint length = 0;
+        gl::GetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::string log(length > 0 ? length : 1, '\0');
+        gl::GetShaderInfoLog(shader, static_cast<GLsizei>(log.size()), nullptr, &log[0]);
+        LOG_ERROR("Failed to compile {} shader: {}", type == GL_VERTEX_SHADER ? "vertex" : "fragment", log);
+        gl::DeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+bool gl_program::build(const char * vertexSource, const char * fragmentSource,
+                       const std::vector<std::pair<GLuint, const char *>> & attributes)
+{
+    release();
+    GLuint vertexShader = compile(GL_VERTEX_SHADER, vertexSource);
+    GLuint fragmentShader = compile(GL_FRAGMENT_SHADER, fragmentSource);
+    if (vertexShader == 0 || fragmentShader == 0) {
+        if (vertexShader != 0)
+            gl::DeleteShader(vertexShader);
+        if (fragmentShader != 0)
+            gl::DeleteShader(fragmentShader);
+        return false;
+    }
+
+    m_program = gl::CreateProgram();
+    gl::AttachShader(m_program, vertexShader);
+    gl::AttachShader(m_program, fragmentShader);
+    for (const auto & attribute : attributes)
+        gl::BindAttribLocation(m_program, attribute.first, attribute.second);
+    gl::LinkProgram(m_program);
+    // shaders are deleted with the program
+    gl::DeleteShader(vertexShader);
+    gl::DeleteShader(fragmentShader);
+
+    GLint status = GL_FALSE;
+    gl::GetProgramiv(m_program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        GLint length = 0;
+        gl::GetProgramiv(m_program, GL_INFO_LOG_LENGTH, &length);
+        std::string log(length > 0 ? length : 1, '\0');
+        gl::GetProgramInfoLog(m_program, static_cast<GLsizei>(log.size()), nullptr, &log[0]);
+        LOG_ERROR("Failed to link shader program: {}", log);
+        release();
+        return false;
+    }
+    return true;
+}
+
+void gl_program::release()
+{
+    if (m_program != 0)
+        gl::DeleteProgram(m_program);
+    m_program = 0;
+}
+
+}
+}
+}
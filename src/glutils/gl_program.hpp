@@ -0,0 +1,43 @@
+#ifndef _GL_PROGRAM_H
+#define _GL_PROGRAM_H
+
+#include <utility>
+#include <vector>
+
+#include "gl_functions.hpp"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+// GLSL program made of a vertex and a fragment shader
+class gl_program {
+public:
+    gl_program() = default;
+    gl_program(const gl_program &) = delete;
+    gl_program & operator=(const gl_program &) = delete;
+
+    // compile and link the shaders, attributes are bound to the given locations before linking
+    // returns false and logs the compilation errors on failure, shaders must be supported
+    bool build(const char * vertexSource, const char * fragmentSource,
+               const std::vector<std::pair<GLuint, const char *>> & attributes = {});
+
+    void use() const { gl::UseProgram(m_program); }
+    static void unuse() { gl::UseProgram(0); }
+
+    GLint uniform(const char * name) const { return gl::GetUniformLocation(m_program, name); }
+
+    bool valid() const { return m_program != 0; }
+
+    // delete the program, a context must be current
+    void release();
+
+private:
+    GLuint m_program = 0;
+};
+
+}
+}
+}
+
+#endif
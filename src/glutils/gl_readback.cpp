@@ -0,0 +1,181 @@
+#include "gl_readback.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "core/Log.h"
+
+namespace SolAR {
+using namespace datastructure;
+namespace MODULES {
+namespace OPENGL {
+
+bool gl_readback::init(unsigned int nbBuffers, unsigned int downscale)
+{
+    release();
+    if (!gl::has_pixel_buffers()) {
+        LOG_ERROR("OpenGL 2.1 pixel buffer objects are required to read the rendered frames back");
+        return false;
+    }
+    m_downscale = std::max(downscale, 1u);
+    if (m_downscale > 1 && !gl::has_framebuffers()) {
+        LOG_WARNING("Frames are read back at full size, scaling them down requires OpenGL 3.0 framebuffer objects");
+        m_downscale = 1;
+    }
+    m_slots.resize(std::max(nbBuffers, 2u));
+    for (slot & s : m_slots)
+        gl::GenBuffers(1, &s.buffer);
+    return true;
+}
+
+bool gl_readback::scale(int width, int height)
+{
+    // (re)allocate the target of the blit when the size of the frame changes
+    if (m_framebuffer == 0) {
+        gl::GenFramebuffers(1, &m_framebuffer);
+        gl::GenRenderbuffers(1, &m_color);
+    }
+    if (width != m_width || height != m_height) {
+        GLint renderbuffer = 0;
+        glGetIntegerv(GL_RENDERBUFFER_BINDING, &renderbuffer);
+        gl::BindRenderbuffer(GL_RENDERBUFFER, m_color);
+        gl::RenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        gl::BindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+        m_width = width;
+        m_height = height;
+    }
+    gl::BindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+    gl::FramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_color);
+    return gl::CheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+void gl_readback::capture(int width, int height)
+{
+    if (m_slots.empty() || width <= 0 || height <= 0)
+        return;
+    slot & s = m_slots[m_next];
+    if (s.pending) {
+        discard(s);
+        ++m_dropped;
+    }
+
+    GLint readFramebuffer = 0, drawFramebuffer = 0, readBuffer = 0, packAlignment = 0;
+    bool scaled = m_downscale > 1 && width >= static_cast<int>(m_downscale) && height >= static_cast<int>(m_downscale);
+    s.width = scaled ? width / m_downscale : width;
+    s.height = scaled ? height / m_downscale : height;
+    if (scaled) {
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+        glGetIntegerv(GL_READ_BUFFER, &readBuffer);
+        if (!scale(s.width, s.height)) {
+            LOG_WARNING("Failed to scale down the frame of {}x{} for its readback", width, height);
+            gl::BindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFramebuffer);
+            return;
+        }
+        gl::BlitFramebuffer(0, 0, width, height, 0, 0, s.width, s.height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        gl::BindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+    }
+
+    // rows of BGR pixels are tightly packed, as in SolAR images
+    glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    GLsizeiptr size = static_cast<GLsizeiptr>(s.width) * s.height * 3;
+    gl::BindBuffer(GL_PIXEL_PACK_BUFFER, s.buffer);
+    if (size > s.capacity) {
+        gl::BufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        s.capacity = size;
+    }
+    glReadPixels(0, 0, s.width, s.height, GL_BGR, GL_UNSIGNED_BYTE, nullptr);
+    gl::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+
+    if (scaled) {
+        gl::BindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+        gl::BindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFramebuffer);
+        glReadBuffer(readBuffer);
+    }
+    if (gl::has_sync())
+        s.fence = gl::FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    s.frame = m_frame++;
+    s.pending = true;
+    m_next = (m_next + 1) % m_slots.size();
+}
+
+bool gl_readback::complete(const slot & s) const
+{
+    if (!s.pending)
+        return false;
+    // without fences, a transfer is assumed complete once the whole ring has been used since
+    if (s.fence == nullptr)
+        return s.frame + latency() <= m_frame;
+    GLenum status = gl::ClientWaitSync(s.fence, 0, 0);
+    return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+void gl_readback::discard(slot & s)
+{
+    if (s.fence != nullptr)
+        gl::DeleteSync(s.fence);
+    s.fence = nullptr;
+    s.pending = false;
+}
+
+SRef<Image> gl_readback::fetch()
+{
+    // transfers complete in order, so the first complete one from the newest is the most recent frame
+    size_t nbSlots = m_slots.size();
+    size_t found = nbSlots;
+    for (size_t i = 1; i <= nbSlots && found == nbSlots; ++i) {
+        size_t index = (m_next + nbSlots - i) % nbSlots;
+        if (complete(m_slots[index]))
+            found = index;
+    }
+    if (found == nbSlots)
+        return nullptr;
+    for (slot & s : m_slots) {
+        if (s.pending && s.frame < m_slots[found].frame) {
+            discard(s);
+            ++m_dropped;
+        }
+    }
+
+    slot & s = m_slots[found];
+    discard(s);
+    gl::BindBuffer(GL_PIXEL_PACK_BUFFER, s.buffer);
+    const unsigned char * pixels = static_cast<const unsigned char *>(gl::MapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+    SRef<Image> image;
+    if (pixels != nullptr) {
+        image = std::make_shared<Image>(s.width, s.height, Image::LAYOUT_BGR, Image::INTERLEAVED, Image::TYPE_8U);
+        // OpenGL rows start from the bottom
+        size_t rowSize = static_cast<size_t>(s.width) * 3;
+        unsigned char * data = static_cast<unsigned char *>(image->data());
+        for (int y = 0; y < s.height; ++y)
+            std::memcpy(data + y * rowSize, pixels + (s.height - 1 - y) * rowSize, rowSize);
+        gl::UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    else
+        LOG_WARNING("Failed to map the readback buffer of frame {}", s.frame);
+    gl::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return image;
+}
+
+void gl_readback::release()
+{
+    for (slot & s : m_slots) {
+        discard(s);
+        gl::DeleteBuffers(1, &s.buffer);
+    }
+    m_slots.clear();
+    if (m_framebuffer != 0) {
+        gl::DeleteFramebuffers(1, &m_framebuffer);
+        gl::DeleteRenderbuffers(1, &m_color);
+    }
+    m_framebuffer = m_color = 0;
+    m_width = m_height = 0;
+    m_next = 0;
+}
+
+}
+}
+}
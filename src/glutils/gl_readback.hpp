@@ -0,0 +1,79 @@
+#ifndef _GL_READBACK_H
+#define _GL_READBACK_H
+
+#include <vector>
+
+#include "datastructure/Image.h"
+
+#include "gl_functions.hpp"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+// Asynchronous copy of rendered frames to SolAR images through a ring of pixel pack buffers
+// capture() only queues the transfer of the frame into the next buffer of the ring, and fetch() maps a buffer once
+// its fence is signaled, so the rendering never waits for the transfer. Frames can be scaled down on the GPU first.
+class gl_readback {
+public:
+    gl_readback() = default;
+    gl_readback(const gl_readback &) = delete;
+    gl_readback & operator=(const gl_readback &) = delete;
+
+    // create a ring of nbBuffers (at least 2) buffers, frames are read at 1 / downscale of their size
+    // a context must be current, returns false if pixel buffer objects are not supported
+    bool init(unsigned int nbBuffers, unsigned int downscale);
+
+    // queue the readback of the width x height pixels of the current read buffer
+    // if the oldest transfer of the ring is still not fetched, its frame is dropped
+    void capture(int width, int height);
+
+    // most recent frame whose transfer is complete, as a BGR image with its first row at the top
+    // older complete frames are dropped, returns nullptr if no transfer is complete yet
+    SRef<datastructure::Image> fetch();
+
+    // number of frames rendered after a frame before it can be fetched, when the GPU keeps up
+    unsigned int latency() const { return m_slots.empty() ? 0 : static_cast<unsigned int>(m_slots.size()) - 1; }
+
+    // number of frames captured and dropped without being fetched
+    uint64_t captured() const { return m_frame; }
+    uint64_t dropped() const { return m_dropped; }
+
+    bool valid() const { return !m_slots.empty(); }
+
+    // free the GPU resources, a context must be current
+    void release();
+
+private:
+    struct slot {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+        GLsizeiptr capacity = 0;
+        int width = 0;
+        int height = 0;
+        uint64_t frame = 0;
+        bool pending = false;
+    };
+
+    bool complete(const slot & s) const;
+    void discard(slot & s);
+    bool scale(int width, int height);
+
+    std::vector<slot> m_slots;
+    size_t m_next = 0;
+    uint64_t m_frame = 0;
+    uint64_t m_dropped = 0;
+    unsigned int m_downscale = 1;
+
+    // framebuffer receiving the scaled down frames
+    GLuint m_framebuffer = 0;
+    GLuint m_color = 0;
+    int m_width = 0;
+    int m_height = 0;
+};
+
+}
+}
+}
+
+#endif
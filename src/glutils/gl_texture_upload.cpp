@@ -0,0 +1,60 @@
+#include "gl_texture_upload.hpp"
+
+#include <cstring>
+
+#include "core/Log.h"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+bool gl_texture_upload::init(unsigned int nbBuffers)
+{
+    release();
+    if (nbBuffers == 0)
+        return true;
+    if (!gl::has_pixel_buffers()) {
+        LOG_ERROR("OpenGL 2.1 pixel buffer objects are required to upload the images asynchronously");
+        return false;
+    }
+    m_buffers.resize(nbBuffers);
+    gl::GenBuffers(nbBuffers, m_buffers.data());
+    return true;
+}
+
+void gl_texture_upload::update(int width, int height, GLenum format, GLenum type, const void * pixels, size_t size)
+{
+    if (m_buffers.empty()) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, type, pixels);
+        return;
+    }
+    gl::BindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffers[m_next]);
+    m_next = (m_next + 1) % m_buffers.size();
+    // new storage for the buffer, so that mapping it does not wait for a previous transfer still reading it
+    gl::BufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    void * mapped = gl::MapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+    if (mapped) {
+        std::memcpy(mapped, pixels, size);
+        if (gl::UnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+            // source offset in the bound buffer
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, type, nullptr);
+            gl::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return;
+        }
+    }
+    // the buffer could not be filled, the pixels are read from client memory
+    gl::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, type, pixels);
+}
+
+void gl_texture_upload::release()
+{
+    if (!m_buffers.empty())
+        gl::DeleteBuffers(static_cast<GLsizei>(m_buffers.size()), m_buffers.data());
+    m_buffers.clear();
+    m_next = 0;
+}
+
+}
+}
+}
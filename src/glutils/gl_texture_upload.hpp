@@ -0,0 +1,45 @@
+#ifndef _GL_TEXTURE_UPLOAD_H
+#define _GL_TEXTURE_UPLOAD_H
+
+#include <vector>
+
+#include "gl_functions.hpp"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+// Asynchronous update of a texture from client memory through a ring of pixel unpack buffers
+// The pixels are copied into the next buffer of the ring and the texture is updated from that buffer, so the call
+// returns once the copy is done and the transfer to the texture overlaps with the rendering of the previous frame.
+// A buffer still read by the GPU is orphaned rather than waited for. Without buffers, the texture is updated from
+// client memory.
+class gl_texture_upload {
+public:
+    gl_texture_upload() = default;
+    gl_texture_upload(const gl_texture_upload &) = delete;
+    gl_texture_upload & operator=(const gl_texture_upload &) = delete;
+
+    // create a ring of nbBuffers buffers (none to update the texture from client memory), a context must be current
+    // returns false if pixel buffer objects are not supported
+    bool init(unsigned int nbBuffers);
+
+    // update the width x height texels of the texture bound to GL_TEXTURE_2D with the size bytes of pixels
+    // the unpack alignment and row length of the pixels must be set by the caller
+    void update(int width, int height, GLenum format, GLenum type, const void * pixels, size_t size);
+
+    bool valid() const { return !m_buffers.empty(); }
+
+    // free the GPU resources, a context must be current
+    void release();
+
+private:
+    std::vector<GLuint> m_buffers;
+    size_t m_next = 0;
+};
+
+}
+}
+}
+
+#endif
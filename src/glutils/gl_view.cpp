@@ -0,0 +1,48 @@
+#include "gl_view.hpp"
+
+namespace SolAR {
+using namespace datastructure;
+namespace MODULES {
+namespace OPENGL {
+
+gl_view gl_view::current(bool culling)
+{
+    gl_view view;
+    Eigen::Matrix4f modelview, projection;
+    GLint viewport[4];
+    glGetFloatv(GL_MODELVIEW_MATRIX, modelview.data());
+    glGetFloatv(GL_PROJECTION_MATRIX, projection.data());
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    view.width = viewport[2];
+    view.height = viewport[3];
+    view.eye = modelview.inverse().col(3).head<3>();
+    // focal length in pixels of the perspective projection
+    view.pixel_scale = projection(1, 1) * view.height * 0.5f;
+    view.clip = projection * modelview;
+
+    if (culling) {
+        // clip space planes -w <= x, y, z <= w brought back to the model frame
+        for (int i = 0; i < 3; ++i) {
+            view.planes[2 * i] = view.clip.row(3) + view.clip.row(i);
+            view.planes[2 * i + 1] = view.clip.row(3) - view.clip.row(i);
+        }
+    }
+    return view;
+}
+
+bool gl_view::sees(const Vector3f & low, const Vector3f & high) const
+{
+    for (const Eigen::Vector4f & plane : planes) {
+        // corner of the box the furthest along the plane normal
+        Vector3f corner(plane[0] >= 0.f ? high[0] : low[0],
+                        plane[1] >= 0.f ? high[1] : low[1],
+                        plane[2] >= 0.f ? high[2] : low[2]);
+        if (plane.head<3>().dot(corner) + plane[3] < 0.f)
+            return false;
+    }
+    return true;
+}
+
+}
+}
+}
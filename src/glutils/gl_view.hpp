@@ -0,0 +1,42 @@
+#ifndef _GL_VIEW_H
+#define _GL_VIEW_H
+
+#include <algorithm>
+
+#include "datastructure/MathDefinitions.h"
+
+#include "gl_functions.hpp"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+// current OpenGL camera, as set by gl_camera::setup, used to select what to draw
+struct gl_view {
+    datastructure::Vector3f eye = datastructure::Vector3f::Zero(); // camera center in the model frame
+    float pixel_scale = 1.f;                              // size in pixels of one unit at a distance of one unit
+    int width = 0, height = 0;                            // viewport size
+    Eigen::Matrix4f clip;                                 // projection * modelview
+    Eigen::Vector4f planes[6];                            // frustum planes in the model frame, inside if n.x + d >= 0
+
+    gl_view() : clip(Eigen::Matrix4f::Identity()) { for (Eigen::Vector4f & plane : planes) plane.setZero(); }
+
+    // read the current modelview and projection matrices and viewport
+    // if culling is false, the frustum planes are left null and every box is visible
+    static gl_view current(bool culling = true);
+
+    // true if both views see the scene from the same point with the same projection
+    bool same(const gl_view & other) const { return clip == other.clip && width == other.width && height == other.height; }
+
+    // size in pixels of length seen at distance
+    float projected_size(float length, float distance) const { return length * pixel_scale / std::max(distance, 1e-6f); }
+
+    // false if the axis aligned box [low, high] is fully outside of the frustum
+    bool sees(const datastructure::Vector3f & low, const datastructure::Vector3f & high) const;
+};
+
+}
+}
+}
+
+#endif
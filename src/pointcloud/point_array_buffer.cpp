@@ -0,0 +1,88 @@
+#include "point_array_buffer.hpp"
+
+namespace SolAR {
+using namespace datastructure;
+namespace MODULES {
+namespace OPENGL {
+
+void point_array_buffer::upload(GLuint & vbo, size_t & capacity, const void * data, size_t bytes)
+{
+    if (vbo == 0)
+        gl::GenBuffers(1, &vbo);
+    gl::BindBuffer(GL_ARRAY_BUFFER, vbo);
+    if (bytes > capacity) {
+        gl::BufferData(GL_ARRAY_BUFFER, bytes, data, GL_DYNAMIC_DRAW);
+        capacity = bytes;
+    }
+    else if (bytes > 0)
+        gl::BufferSubData(GL_ARRAY_BUFFER, 0, bytes, data);
+}
+
+void point_array_buffer::set_arrays(const float * positions, const float * colors, const int * labels, size_t size)
+{
+    m_size = positions ? size : 0;
+    if (m_size == 0)
+        return;
+
+    upload(m_positions_vbo, m_positions_capacity, positions, m_size * 3 * sizeof(float));
+    m_has_colors = colors != nullptr;
+    if (m_has_colors)
+        upload(m_colors_vbo, m_colors_capacity, colors, m_size * 3 * sizeof(float));
+    m_has_labels = labels != nullptr && gl::has_shaders();
+    if (m_has_labels)
+        upload(m_labels_vbo, m_labels_capacity, labels, m_size * sizeof(int));
+    gl::BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void point_array_buffer::draw()
+{
+    if (m_size == 0)
+        return;
+
+    // SolAR to OpenGL frame
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glScalef(1.f, -1.f, -1.f);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    gl::BindBuffer(GL_ARRAY_BUFFER, m_positions_vbo);
+    glVertexPointer(3, GL_FLOAT, 0, nullptr);
+    if (m_has_colors && m_vertex_colors) {
+        glEnableClientState(GL_COLOR_ARRAY);
+        gl::BindBuffer(GL_ARRAY_BUFFER, m_colors_vbo);
+        glColorPointer(3, GL_FLOAT, 0, nullptr);
+    }
+    if (m_has_labels) {
+        gl::EnableVertexAttribArray(POINT_LABEL_LOCATION);
+        gl::BindBuffer(GL_ARRAY_BUFFER, m_labels_vbo);
+        gl::VertexAttribPointer(POINT_LABEL_LOCATION, 1, GL_INT, GL_FALSE, 0, nullptr);
+    }
+    else if (gl::has_shaders())
+        // no semantic id
+        gl::VertexAttrib1f(POINT_LABEL_LOCATION, -1.f);
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(m_size));
+    if (m_has_labels)
+        gl::DisableVertexAttribArray(POINT_LABEL_LOCATION);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    gl::BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glPopMatrix();
+}
+
+void point_array_buffer::release()
+{
+    if (m_positions_vbo != 0)
+        gl::DeleteBuffers(1, &m_positions_vbo);
+    if (m_colors_vbo != 0)
+        gl::DeleteBuffers(1, &m_colors_vbo);
+    if (m_labels_vbo != 0)
+        gl::DeleteBuffers(1, &m_labels_vbo);
+    m_positions_vbo = m_colors_vbo = m_labels_vbo = 0;
+    m_positions_capacity = m_colors_capacity = m_labels_capacity = 0;
+    m_size = 0;
+}
+
+}
+}
+}
@@ -0,0 +1,60 @@
+#ifndef _POINT_ARRAY_BUFFER_H
+#define _POINT_ARRAY_BUFFER_H
+
+#include <vector>
+
+#include "point_cloud_buffer.hpp"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+// GPU vertex buffers of a point cloud given as structure of arrays (positions, colors, labels)
+// The arrays are borrowed for the duration of set_arrays only: they are uploaded straight from the caller
+// memory, without intermediate copy nor conversion to the OpenGL frame. Colors are chosen by point_shader.
+class point_array_buffer {
+public:
+    point_array_buffer() = default;
+    point_array_buffer(const point_array_buffer &) = delete;
+    point_array_buffer & operator=(const point_array_buffer &) = delete;
+
+    // upload the arrays, a context must be current
+    // positions: x, y, z for each point in the SolAR frame
+    // colors (optional): r, g, b in [0..1] for each point, else points have the current color
+    // labels (optional): semantic id of each point, negative if none
+    void set_arrays(const float * positions, const float * colors, const int * labels, size_t size);
+
+    // if false, the color array is not bound and points are drawn with the current color
+    void use_vertex_colors(bool use) { m_vertex_colors = use; }
+
+    // draw the points as GL_POINTS
+    void draw();
+
+    // free the GPU buffers, a context must be current
+    void release();
+
+    void clear() { m_size = 0; }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+private:
+    static void upload(GLuint & vbo, size_t & capacity, const void * data, size_t bytes);
+
+    GLuint m_positions_vbo = 0;
+    GLuint m_colors_vbo = 0;
+    GLuint m_labels_vbo = 0;
+    size_t m_positions_capacity = 0;
+    size_t m_colors_capacity = 0;
+    size_t m_labels_capacity = 0;
+    size_t m_size = 0;
+    bool m_has_colors = false;
+    bool m_has_labels = false;
+    bool m_vertex_colors = true;
+};
+
+}
+}
+}
+
+#endif
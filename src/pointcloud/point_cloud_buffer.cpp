@@ -0,0 +1,332 @@
+#include "point_cloud_buffer.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+
+#include "core/Log.h"
+
+namespace SolAR {
+using namespace datastructure;
+namespace MODULES {
+namespace OPENGL {
+
+// dirty vertices closer than this are uploaded with a single glBufferSubData
+static const uint32_t UPLOAD_MERGE_GAP = 256;
+
+static void pack_vertex(const CloudPoint & point, point_vertex & vertex)
+{
+    // SolAR to OpenGL frame
+    vertex.position[0] = point.getX();
+    vertex.position[1] = -point.getY();
+    vertex.position[2] = -point.getZ();
+    vertex.color[0] = point.getR();
+    vertex.color[1] = point.getG();
+    vertex.color[2] = point.getB();
+    vertex.label = static_cast<float>(point.getSemanticId());
+}
+
+// value of m_packed_slots for points which are not in the buffer yet
+static const uint32_t NEW_POINT = 0xFFFFFFFE;
+
+// points read from the CloudPoint objects
+struct cloud_point_source {
+    const std::vector<SRef<CloudPoint>> & points;
+    uint32_t id(size_t i) const { return points[i]->getId(); }
+    void pack(size_t i, point_vertex & vertex) const { pack_vertex(*points[i], vertex); }
+};
+
+// points already packed, e.g. by the thread which gave them to the viewer
+struct packed_point_source {
+    const packed_points & points;
+    uint32_t id(size_t i) const { return points.ids[i]; }
+    void pack(size_t i, point_vertex & vertex) const { vertex = points.vertices[i]; }
+};
+
+void packed_points::pack(const std::vector<SRef<CloudPoint>> & points, worker_pool * pool)
+{
+    vertices.resize(points.size());
+    ids.resize(points.size());
+    parallel_for(pool, points.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            pack_vertex(*points[i], vertices[i]);
+            ids[i] = points[i]->getId();
+        }
+    });
+}
+
+void point_cloud_buffer::set_points(const std::vector<SRef<CloudPoint>> & points, worker_pool * pool)
+{
+    set_points(cloud_point_source{points}, points.size(), pool);
+}
+
+void point_cloud_buffer::set_points(const packed_points & points, worker_pool * pool)
+{
+    set_points(packed_point_source{points}, points.size(), pool);
+}
+
+template <typename Source>
+void point_cloud_buffer::set_points(const Source & source, size_t nbPoints, worker_pool * pool)
+{
+    // ids found not unique are not checked again until the number of points changes
+    if (m_duplicate_ids && nbPoints == m_vertices.size()) {
+        set_points_by_index(source, nbPoints, pool);
+        return;
+    }
+    m_duplicate_ids = false;
+    if (set_points_by_id(source, nbPoints, pool))
+        return;
+    // the vertices have been put back in the order of the points
+    m_duplicate_ids = true;
+    set_untracked();
+}
+
+template <typename Source>
+bool point_cloud_buffer::set_points_by_id(const Source & source, size_t nbPoints, worker_pool * pool)
+{
+    if (!m_tracked) {
+        // previous content was not keyed by id, start from scratch
+        m_vertices.clear();
+        m_ids.clear();
+        m_generations.clear();
+        m_slots.clear();
+        m_tracked = true;
+        m_full_upload = true;
+        m_changes.reset = true;
+    }
+
+    // pack each point once and find its slot, in parallel: the new points go to the scratch, the known ones are
+    // compared to their slot and only kept as patches if they moved or were recolored
+    m_packed.resize(nbPoints);
+    m_packed_ids.resize(nbPoints);
+    m_packed_slots.resize(nbPoints);
+    m_patches.clear();
+    std::mutex patchesMutex;
+    parallel_for(pool, nbPoints, [&](size_t begin, size_t end) {
+        std::vector<vertex_patch> patches;
+        point_vertex vertex;
+        for (size_t i = begin; i < end; ++i) {
+            m_packed_ids[i] = source.id(i);
+            auto it = m_slots.find(m_packed_ids[i]);
+            if (it == m_slots.end()) {
+                m_packed_slots[i] = NEW_POINT;
+                source.pack(i, m_packed[i]);
+                continue;
+            }
+            m_packed_slots[i] = it->second;
+            source.pack(i, vertex);
+            if (std::memcmp(&m_vertices[it->second], &vertex, sizeof(point_vertex)) != 0)
+                patches.push_back({static_cast<uint32_t>(i), it->second, vertex});
+        }
+        if (!patches.empty()) {
+            std::lock_guard<std::mutex> lock(patchesMutex);
+            m_patches.insert(m_patches.end(), patches.begin(), patches.end());
+        }
+    });
+
+    // changes not consumed since the previous call can not be chained
+    if (m_record_changes && has_changes())
+        m_changes.reset = true;
+    uint32_t firstNewSlot = static_cast<uint32_t>(m_vertices.size());
+    m_changes.appended_begin = m_changes.appended_end = firstNewSlot;
+
+    // register the new points and check that ids are unique
+    ++m_generation;
+    for (size_t i = 0; i < nbPoints; ++i) {
+        uint32_t slot = m_packed_slots[i];
+        if (slot == NEW_POINT) {
+            slot = static_cast<uint32_t>(m_vertices.size());
+            if (!m_slots.emplace(m_packed_ids[i], slot).second) {
+                restore_packed_order(firstNewSlot);
+                return false;
+            }
+            mark_dirty(slot);
+            m_vertices.push_back(m_packed[i]);
+            m_ids.push_back(m_packed_ids[i]);
+            m_generations.push_back(m_generation);
+            ++m_changes.appended_end;
+        }
+        else if (m_generations[slot] == m_generation) {
+            restore_packed_order(firstNewSlot);
+            return false;
+        }
+        else
+            m_generations[slot] = m_generation;
+    }
+
+    // patch the moved or recolored points in place
+    // the moved points are journaled as well, structures indexing the slots by position must move them too
+    bool recordMoves = m_record_changes && !m_changes.reset;
+    for (const vertex_patch & patch : m_patches) {
+        if (recordMoves && std::memcmp(m_vertices[patch.slot].position, patch.vertex.position, sizeof(point_vertex::position)) != 0)
+            m_changes.moved.push_back(patch.slot);
+        m_vertices[patch.slot] = patch.vertex;
+        mark_dirty(patch.slot);
+    }
+
+    if (nbPoints != m_vertices.size())
+        remove_unseen();
+    return true;
+}
+
+void point_cloud_buffer::restore_packed_order(uint32_t firstNewSlot)
+{
+    // the same id is used twice, points can not be tracked: the vertices are put back in the order of the points
+    // from the scratch, the unchanged slots and the patches, without packing them again
+    m_vertices.resize(firstNewSlot);
+    for (size_t i = 0; i < m_packed.size(); ++i) {
+        if (m_packed_slots[i] != NEW_POINT)
+            m_packed[i] = m_vertices[m_packed_slots[i]];
+    }
+    for (const vertex_patch & patch : m_patches)
+        m_packed[patch.index] = patch.vertex;
+    m_vertices.swap(m_packed);
+}
+
+template <typename Source>
+void point_cloud_buffer::set_points_by_index(const Source & source, size_t nbPoints, worker_pool * pool)
+{
+    m_vertices.resize(nbPoints);
+    parallel_for(pool, nbPoints, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            source.pack(i, m_vertices[i]);
+    });
+    set_untracked();
+}
+
+void point_cloud_buffer::set_untracked()
+{
+    m_tracked = false;
+    m_ids.clear();
+    m_generations.clear();
+    m_slots.clear();
+    m_full_upload = true;
+    m_changes.reset = true;
+    m_dirty_slots.clear();
+}
+
+void point_cloud_buffer::remove_unseen()
+{
+    // fill the holes left by removed points with the last points of the buffer
+    uint32_t slot = 0;
+    while (slot < m_vertices.size()) {
+        if (m_generations[slot] == m_generation) {
+            ++slot;
+            continue;
+        }
+        m_slots.erase(m_ids[slot]);
+        uint32_t last = static_cast<uint32_t>(m_vertices.size() - 1);
+        if (m_record_changes && !m_changes.reset)
+            m_changes.removals.emplace_back(slot, slot != last ? last : point_buffer_changes::NONE);
+        if (slot != last) {
+            m_vertices[slot] = m_vertices[last];
+            m_ids[slot] = m_ids[last];
+            m_generations[slot] = m_generations[last];
+            if (m_generations[slot] == m_generation)
+                m_slots[m_ids[slot]] = slot;
+            mark_dirty(slot);
+        }
+        m_vertices.pop_back();
+        m_ids.pop_back();
+        m_generations.pop_back();
+    }
+}
+
+void point_cloud_buffer::upload()
+{
+    if (m_vbo == 0)
+        gl::GenBuffers(1, &m_vbo);
+    gl::BindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    if (m_vertices.size() > m_gpu_capacity) {
+        // grow with some headroom so that a growing map does not reallocate at each frame
+        m_gpu_capacity = m_vertices.size() + m_vertices.size() / 2;
+        gl::BufferData(GL_ARRAY_BUFFER, m_gpu_capacity * sizeof(point_vertex), nullptr, GL_DYNAMIC_DRAW);
+        m_full_upload = true;
+    }
+
+    if (!m_full_upload && m_dirty_slots.size() > m_vertices.size() / 2)
+        m_full_upload = true;
+
+    if (m_full_upload) {
+        if (!m_vertices.empty())
+            gl::BufferSubData(GL_ARRAY_BUFFER, 0, m_vertices.size() * sizeof(point_vertex), m_vertices.data());
+    }
+    else {
+        // upload the modified ranges only
+        std::sort(m_dirty_slots.begin(), m_dirty_slots.end());
+        size_t i = 0;
+        while (i < m_dirty_slots.size() && m_dirty_slots[i] < m_vertices.size()) {
+            uint32_t first = m_dirty_slots[i];
+            uint32_t last = first;
+            while (++i < m_dirty_slots.size() && m_dirty_slots[i] < m_vertices.size()
+                   && m_dirty_slots[i] <= last + UPLOAD_MERGE_GAP)
+                last = m_dirty_slots[i];
+            gl::BufferSubData(GL_ARRAY_BUFFER, first * sizeof(point_vertex), (last - first + 1) * sizeof(point_vertex), &m_vertices[first]);
+        }
+    }
+    m_dirty_slots.clear();
+    m_full_upload = false;
+}
+
+void point_cloud_buffer::flush()
+{
+    if (m_full_upload || !m_dirty_slots.empty()) {
+        upload();
+        gl::BindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+void point_cloud_buffer::bind()
+{
+    if (m_full_upload || !m_dirty_slots.empty())
+        upload();
+
+    gl::BindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(point_vertex), reinterpret_cast<const void *>(offsetof(point_vertex, position)));
+    if (m_vertex_colors) {
+        glEnableClientState(GL_COLOR_ARRAY);
+        glColorPointer(3, GL_FLOAT, sizeof(point_vertex), reinterpret_cast<const void *>(offsetof(point_vertex, color)));
+    }
+    if (gl::has_shaders()) {
+        gl::EnableVertexAttribArray(POINT_LABEL_LOCATION);
+        gl::VertexAttribPointer(POINT_LABEL_LOCATION, 1, GL_FLOAT, GL_FALSE, sizeof(point_vertex),
+                                reinterpret_cast<const void *>(offsetof(point_vertex, label)));
+    }
+}
+
+void point_cloud_buffer::unbind()
+{
+    if (gl::has_shaders())
+        gl::DisableVertexAttribArray(POINT_LABEL_LOCATION);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    gl::BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void point_cloud_buffer::draw()
+{
+    if (m_vertices.empty()) {
+        if (m_full_upload || !m_dirty_slots.empty())
+            upload();
+        return;
+    }
+    bind();
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(m_vertices.size()));
+    unbind();
+}
+
+void point_cloud_buffer::release()
+{
+    if (m_vbo != 0)
+        gl::DeleteBuffers(1, &m_vbo);
+    m_vbo = 0;
+    m_gpu_capacity = 0;
+    m_dirty_slots.clear();
+    m_full_upload = !m_vertices.empty();
+}
+
+}
+}
+}
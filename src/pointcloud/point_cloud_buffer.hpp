@@ -0,0 +1,157 @@
+#ifndef _POINT_CLOUD_BUFFER_H
+#define _POINT_CLOUD_BUFFER_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "datastructure/CloudPoint.h"
+
+#include "src/glutils/gl_functions.hpp"
+#include "worker_pool.hpp"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+// interleaved vertex layout of a point, position already expressed in the OpenGL frame
+// the color actually displayed is chosen at draw time by point_shader
+struct point_vertex {
+    float position[3];
+    float color[3];                                       // color of the point
+    float label;                                          // semantic id, negative if none
+};
+
+// attribute location of point_vertex::label in point_shader
+static const GLuint POINT_LABEL_LOCATION = 1;
+
+// how the color of each point is chosen when drawing a cloud
+struct point_color_options {
+    bool use_class_label = false;                           // color from the semantic id through the color map
+    bool fixed_color = false;                               // same color for all points
+    float color[3] = {1.f, 1.f, 1.f};                       // fixed color in [0..1]
+};
+
+// structural changes of a point_cloud_buffer between two calls to set_points, for structures indexing its slots
+struct point_buffer_changes {
+    static constexpr uint32_t NONE = 0xFFFFFFFF;
+
+    bool reset = true;                                    // all slots may have changed, indexing structures must be rebuilt
+    uint32_t appended_begin = 0;                          // slots of the new points, before the removals
+    uint32_t appended_end = 0;
+    std::vector<uint32_t> moved;                          // patched slots whose position changed, before the removals
+    std::vector<std::pair<uint32_t, uint32_t>> removals;  // in order: removed slot, slot moved into it or NONE
+};
+
+// points packed into vertices along with their CloudPoint id, a copy of a cloud that can be handed over to another thread
+struct packed_points {
+    std::vector<point_vertex> vertices;
+    std::vector<uint32_t> ids;
+
+    // the packing is spread over the threads of pool if given
+    void pack(const std::vector<SRef<datastructure::CloudPoint>> & points, worker_pool * pool = nullptr);
+    void clear() { vertices.clear(); ids.clear(); }
+    size_t size() const { return vertices.size(); }
+};
+
+// CPU copy and GPU vertex buffer of a point cloud, drawn with a single call
+// Points are tracked by CloudPoint id between two calls to set_points: new points are appended, moved or
+// recolored points are patched in place and removed points are compacted, so that only the modified
+// vertices are sent to the GPU. If ids are not unique, the cloud is repacked as a whole, without tracking its
+// points again until their number changes.
+class point_cloud_buffer {
+public:
+    point_cloud_buffer() = default;
+    point_cloud_buffer(const point_cloud_buffer &) = delete;
+    point_cloud_buffer & operator=(const point_cloud_buffer &) = delete;
+
+    // pack the points into interleaved vertices, the upload is deferred to the next draw
+    // the packing is spread over the threads of pool if given
+    void set_points(const std::vector<SRef<datastructure::CloudPoint>> & points, worker_pool * pool = nullptr);
+
+    // same with points already packed, tracked by their ids
+    void set_points(const packed_points & points, worker_pool * pool = nullptr);
+
+    // remove all points
+    void clear() { set_points(packed_points()); }
+
+    // if false, the color array is not bound and points are drawn with the current color
+    void use_vertex_colors(bool use) { m_vertex_colors = use; }
+
+    // upload the vertices if they changed since the last upload, otherwise done by the next draw
+    void flush();
+    bool upload_pending() const { return m_full_upload || !m_dirty_slots.empty(); }
+
+    // upload the vertices if they changed since the last call and draw them as GL_POINTS
+    void draw();
+
+    // upload the vertices if they changed and bind them as vertex, color and label arrays, to draw a subset of them
+    void bind();
+    static void unbind();
+
+    const std::vector<point_vertex> & vertices() const { return m_vertices; }
+
+    // record the structural changes made by the next call to set_points
+    void record_changes(bool record) { m_record_changes = record; m_changes = point_buffer_changes(); }
+    const point_buffer_changes & changes() const { return m_changes; }
+    bool has_changes() const
+    {
+        return m_changes.reset || m_changes.appended_end > m_changes.appended_begin || !m_changes.moved.empty()
+               || !m_changes.removals.empty();
+    }
+    void clear_changes() { m_changes = point_buffer_changes(); m_changes.reset = false; }
+
+    // free the GPU buffer, a context must be current
+    void release();
+
+    size_t size() const { return m_vertices.size(); }
+    bool empty() const { return m_vertices.empty(); }
+
+private:
+    // source gives the id of a point and packs it, for the CloudPoint objects or for points already packed
+    template <typename Source> void set_points(const Source & source, size_t nbPoints, worker_pool * pool);
+    template <typename Source> bool set_points_by_id(const Source & source, size_t nbPoints, worker_pool * pool);
+    template <typename Source> void set_points_by_index(const Source & source, size_t nbPoints, worker_pool * pool);
+    void restore_packed_order(uint32_t firstNewSlot);
+    void set_untracked();
+    void remove_unseen();
+    void mark_dirty(uint32_t slot) { if (!m_full_upload) m_dirty_slots.push_back(slot); }
+    void upload();
+
+    std::vector<point_vertex> m_vertices;
+    std::vector<uint32_t> m_ids;                          // slot -> CloudPoint id
+    std::vector<uint32_t> m_generations;                  // slot -> last call to set_points the point was seen
+    std::unordered_map<uint32_t, uint32_t> m_slots;       // CloudPoint id -> slot
+    uint32_t m_generation = 0;
+    bool m_tracked = false;                               // m_ids/m_slots are valid
+    bool m_duplicate_ids = false;                         // the ids of the last points were not unique
+
+    std::vector<uint32_t> m_dirty_slots;                  // slots modified since the last upload
+    bool m_full_upload = false;                           // the whole buffer must be uploaded
+
+    // packed point moved or recolored, to write into its slot
+    struct vertex_patch {
+        uint32_t index;                                   // index of the point in the input
+        uint32_t slot;
+        point_vertex vertex;
+    };
+
+    // packing scratch, indexed as the input points, only the new points are written to m_packed
+    std::vector<point_vertex> m_packed;
+    std::vector<uint32_t> m_packed_ids;
+    std::vector<uint32_t> m_packed_slots;                 // slot of the point or NEW_POINT
+    std::vector<vertex_patch> m_patches;
+
+    bool m_record_changes = false;
+    point_buffer_changes m_changes;
+
+    GLuint m_vbo = 0;
+    size_t m_gpu_capacity = 0;
+    bool m_vertex_colors = true;
+};
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,263 @@
+#include "point_octree.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace SolAR {
+using namespace datastructure;
+namespace MODULES {
+namespace OPENGL {
+
+static const int MAX_DEPTH = 16;
+
+// the root box is larger than the cloud so that a growing map does not trigger a rebuild at each frame
+static const float ROOT_MARGIN = 2.f;
+
+uint32_t point_octree::cell(const node & n, const float * position) const
+{
+    uint32_t index[3];
+    for (int i = 0; i < 3; ++i) {
+        int c = static_cast<int>((position[i] - n.origin[i]) / n.size * GRID);
+        index[i] = static_cast<uint32_t>(std::min(std::max(c, 0), GRID - 1));
+    }
+    return (index[2] * GRID + index[1]) * GRID + index[0];
+}
+
+bool point_octree::insert(uint32_t slot, const std::vector<point_vertex> & vertices)
+{
+    const float * position = vertices[slot].position;
+    const node & root = m_nodes[0];
+    for (int i = 0; i < 3; ++i) {
+        if (position[i] < root.origin[i] || position[i] > root.origin[i] + root.size)
+            return false;
+    }
+
+    uint32_t current = 0;
+    while (true) {
+        node & n = m_nodes[current];
+        uint32_t c = cell(n, position);
+        if (!n.cells[c] || n.depth >= MAX_DEPTH) {
+            n.cells[c] = true;
+            m_locations[slot] = {current, static_cast<uint32_t>(n.slots.size()), c};
+            n.slots.push_back(slot);
+            return true;
+        }
+        // the cell is already represented at this level, go down to the child containing the point
+        float half = n.size * 0.5f;
+        int octant = 0;
+        for (int i = 0; i < 3; ++i) {
+            if (position[i] >= n.origin[i] + half)
+                octant |= 1 << i;
+        }
+        uint32_t child = n.children[octant];
+        if (child == NONE) {
+            child = static_cast<uint32_t>(m_nodes.size());
+            node created;
+            created.size = half;
+            created.depth = n.depth + 1;
+            for (int i = 0; i < 3; ++i)
+                created.origin[i] = n.origin[i] + ((octant >> i) & 1 ? half : 0.f);
+            // n is invalidated by the insertion
+            m_nodes[current].children[octant] = child;
+            m_nodes.push_back(std::move(created));
+        }
+        current = child;
+    }
+}
+
+void point_octree::remove(uint32_t slot)
+{
+    location & removed = m_locations[slot];
+    if (removed.node == NONE)
+        return;
+    node & n = m_nodes[removed.node];
+    n.cells[removed.cell] = false;
+    uint32_t last = n.slots.back();
+    n.slots[removed.index] = last;
+    m_locations[last].index = removed.index;
+    n.slots.pop_back();
+    n.uploaded = std::min<size_t>(n.uploaded, removed.index);
+    removed.node = NONE;
+}
+
+void point_octree::relabel(uint32_t from, uint32_t to)
+{
+    location & moved = m_locations[from];
+    if (moved.node == PENDING)
+        m_pending[moved.index] = to;
+    else if (moved.node != NONE) {
+        node & n = m_nodes[moved.node];
+        n.slots[moved.index] = to;
+        n.uploaded = std::min<size_t>(n.uploaded, moved.index);
+    }
+    m_locations[to] = moved;
+    moved.node = NONE;
+}
+
+void point_octree::clear()
+{
+    for (const node & n : m_nodes) {
+        if (n.ebo != 0)
+            m_orphans.push_back(n.ebo);
+    }
+    m_nodes.clear();
+    m_locations.clear();
+}
+
+void point_octree::rebuild(const std::vector<point_vertex> & vertices)
+{
+    clear();
+    if (vertices.empty())
+        return;
+
+    Vector3f low = Vector3f::Constant(std::numeric_limits<float>::max());
+    Vector3f high = Vector3f::Constant(std::numeric_limits<float>::lowest());
+    for (const point_vertex & vertex : vertices) {
+        Eigen::Map<const Vector3f> position(vertex.position);
+        low = low.cwiseMin(position);
+        high = high.cwiseMax(position);
+    }
+    node root;
+    root.size = std::max((high - low).maxCoeff() * ROOT_MARGIN, 1e-6f);
+    root.origin = (low + high) * 0.5f - Vector3f::Constant(root.size * 0.5f);
+    m_nodes.push_back(std::move(root));
+    m_locations.resize(vertices.size());
+
+    // insert in a scattered order so that the coarse levels sample the whole cloud evenly
+    uint64_t nbPoints = vertices.size();
+    uint64_t step = 2654435761u % nbPoints;
+    while (std::gcd(std::max<uint64_t>(step, 1), nbPoints) != 1)
+        ++step;
+    step = std::max<uint64_t>(step, 1);
+    for (uint64_t i = 0; i < nbPoints; ++i)
+        insert(static_cast<uint32_t>((i * step) % nbPoints), vertices);
+}
+
+void point_octree::sync(point_cloud_buffer & buffer)
+{
+    const point_buffer_changes & changes = buffer.changes();
+    const std::vector<point_vertex> & vertices = buffer.vertices();
+    if (changes.reset || m_nodes.empty()) {
+        rebuild(vertices);
+        buffer.clear_changes();
+        return;
+    }
+
+    m_locations.resize(std::max<size_t>(m_locations.size(), changes.appended_end));
+    m_pending.resize(changes.appended_end - changes.appended_begin);
+    std::iota(m_pending.begin(), m_pending.end(), changes.appended_begin);
+    // moved points leave their node, and are inserted again with the appended ones
+    for (uint32_t slot : changes.moved) {
+        remove(slot);
+        m_locations[slot] = {PENDING, static_cast<uint32_t>(m_pending.size()), 0};
+        m_pending.push_back(slot);
+    }
+    for (const auto & removal : changes.removals) {
+        remove(removal.first);
+        uint32_t from = removal.second;
+        if (from == point_buffer_changes::NONE)
+            continue;
+        if (from >= changes.appended_begin && from < changes.appended_end)
+            m_pending[from - changes.appended_begin] = removal.first;
+        else
+            relabel(from, removal.first);
+    }
+    m_locations.resize(vertices.size());
+
+    for (uint32_t slot : m_pending) {
+        if (!insert(slot, vertices)) {
+            // out of the root box, also for a point moved away
+            rebuild(vertices);
+            break;
+        }
+    }
+    buffer.clear_changes();
+}
+
+void point_octree::upload(node & n)
+{
+    if (n.ebo == 0)
+        gl::GenBuffers(1, &n.ebo);
+    gl::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, n.ebo);
+    if (n.slots.size() > n.gpu_capacity) {
+        n.gpu_capacity = std::max<size_t>(n.slots.size() + n.slots.size() / 2, 256);
+        gl::BufferData(GL_ELEMENT_ARRAY_BUFFER, n.gpu_capacity * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+        n.uploaded = 0;
+    }
+    if (n.uploaded < n.slots.size())
+        gl::BufferSubData(GL_ELEMENT_ARRAY_BUFFER, n.uploaded * sizeof(uint32_t),
+                          (n.slots.size() - n.uploaded) * sizeof(uint32_t), &n.slots[n.uploaded]);
+    n.uploaded = n.slots.size();
+}
+
+size_t point_octree::draw(point_cloud_buffer & buffer, const gl_view & view, float screenError, size_t budget)
+{
+    if (!m_orphans.empty()) {
+        gl::DeleteBuffers(static_cast<GLsizei>(m_orphans.size()), m_orphans.data());
+        m_orphans.clear();
+    }
+    if (m_nodes.empty())
+        return 0;
+    if (budget == 0)
+        budget = std::numeric_limits<size_t>::max();
+
+    // projected point spacing of a node
+    auto spacing = [&view](const node & n) {
+        Vector3f center = n.origin + Vector3f::Constant(n.size * 0.5f);
+        float distance = (view.eye - center).norm() - n.size * 0.866f;
+        return view.projected_size(n.size / GRID, distance);
+    };
+
+    size_t nbDrawn = 0;
+    buffer.bind();
+    m_queue.assign(1, {spacing(m_nodes[0]), 0});
+    while (!m_queue.empty() && nbDrawn < budget) {
+        std::pop_heap(m_queue.begin(), m_queue.end());
+        node & n = m_nodes[m_queue.back().second];
+        float nodeSpacing = m_queue.back().first;
+        m_queue.pop_back();
+        // the points of the node and of its children are inside its box
+        if (!view.sees(n.origin, n.origin + Vector3f::Constant(n.size)))
+            continue;
+        if (!n.slots.empty()) {
+            if (n.uploaded != n.slots.size() || n.ebo == 0)
+                upload(n);
+            else
+                gl::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, n.ebo);
+            size_t count = std::min(n.slots.size(), budget - nbDrawn);
+            glDrawElements(GL_POINTS, static_cast<GLsizei>(count), GL_UNSIGNED_INT, nullptr);
+            nbDrawn += count;
+        }
+        // refine while the point spacing of the node is visible
+        if (nodeSpacing <= screenError)
+            continue;
+        for (uint32_t child : n.children) {
+            if (child != NONE) {
+                m_queue.emplace_back(spacing(m_nodes[child]), child);
+                std::push_heap(m_queue.begin(), m_queue.end());
+            }
+        }
+    }
+    gl::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    point_cloud_buffer::unbind();
+    return nbDrawn;
+}
+
+void point_octree::release()
+{
+    for (node & n : m_nodes) {
+        if (n.ebo != 0)
+            gl::DeleteBuffers(1, &n.ebo);
+        n.ebo = 0;
+        n.gpu_capacity = 0;
+        n.uploaded = 0;
+    }
+    if (!m_orphans.empty())
+        gl::DeleteBuffers(static_cast<GLsizei>(m_orphans.size()), m_orphans.data());
+    m_orphans.clear();
+}
+
+}
+}
+}
@@ -0,0 +1,86 @@
+#ifndef _POINT_OCTREE_H
+#define _POINT_OCTREE_H
+
+#include <bitset>
+#include <cstdint>
+#include <vector>
+
+#include "point_cloud_buffer.hpp"
+#include "src/glutils/gl_view.hpp"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+// Level of detail of a point_cloud_buffer based on a nested octree
+// Each node keeps at most one point per cell of a GRID^3 grid over its box, the other points go down to its children.
+// A node and its ancestors thus give a subsample of the cloud with a spacing of node size / GRID, and nodes are
+// refined while this spacing projects to more than the screen space error. Nodes reference the slots of the buffer
+// through their own index buffer, and follow its changes incrementally: new points are inserted, removed points are
+// removed and moved points are removed then inserted again. The tree is rebuilt when the buffer is repacked or when
+// points are added or moved outside of its box.
+// As the points of a node are inserted in a scattered order, any prefix of a node is an even subsample of it.
+class point_octree {
+public:
+    static const int GRID = 32;
+
+    point_octree() = default;
+    point_octree(const point_octree &) = delete;
+    point_octree & operator=(const point_octree &) = delete;
+
+    // update the tree with the changes of the buffer since the last call, which are then cleared
+    void sync(point_cloud_buffer & buffer);
+
+    // draw the nodes in the view frustum whose point spacing projects to more than screenError pixels
+    // nodes are drawn from the coarsest on screen, and the drawing stops after budget points if budget is not 0
+    // buffer must be the synced one, returns the number of points drawn
+    size_t draw(point_cloud_buffer & buffer, const gl_view & view, float screenError, size_t budget = 0);
+
+    // free the GPU buffers, a context must be current
+    void release();
+
+    // remove all nodes, their GPU buffers are freed at next draw
+    void clear();
+    size_t nb_nodes() const { return m_nodes.size(); }
+
+private:
+    static const uint32_t NONE = 0xFFFFFFFF;
+    static const uint32_t PENDING = 0xFFFFFFFE;           // location of a slot waiting in m_pending, at index
+
+    struct node {
+        datastructure::Vector3f origin;                   // min corner of the node box
+        float size = 0.f;                                 // edge of the node box
+        uint32_t children[8] = {NONE, NONE, NONE, NONE, NONE, NONE, NONE, NONE};
+        int depth = 0;
+        std::vector<uint32_t> slots;                      // slots of the points of the node in the buffer
+        std::bitset<GRID * GRID * GRID> cells;            // occupied cells
+        GLuint ebo = 0;
+        size_t gpu_capacity = 0;
+        size_t uploaded = 0;                              // slots[0, uploaded) are up to date on the GPU
+    };
+
+    struct location {
+        uint32_t node = NONE;
+        uint32_t index = 0;                               // position in node.slots
+        uint32_t cell = 0;                                // occupied cell of the node
+    };
+
+    void rebuild(const std::vector<point_vertex> & vertices);
+    bool insert(uint32_t slot, const std::vector<point_vertex> & vertices);
+    void remove(uint32_t slot);
+    void relabel(uint32_t from, uint32_t to);
+    uint32_t cell(const node & n, const float * position) const;
+    void upload(node & n);
+
+    std::vector<node> m_nodes;                            // m_nodes[0] is the root
+    std::vector<location> m_locations;                    // slot -> node and position in the node
+    std::vector<uint32_t> m_pending;                      // scratch: slots of the appended and moved points
+    std::vector<std::pair<float, uint32_t>> m_queue;      // scratch: traversal, nodes by projected point spacing
+    std::vector<GLuint> m_orphans;                        // index buffers of deleted nodes, freed at next draw
+};
+
+}
+}
+}
+
+#endif
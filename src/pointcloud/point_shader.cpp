@@ -0,0 +1,128 @@
+#include "point_shader.hpp"
+
+#include <algorithm>
+
+#include "core/Log.h"
+
+namespace SolAR {
+using namespace datastructure;
+namespace MODULES {
+namespace OPENGL {
+
+// values of the color_mode uniform
+static const GLint VERTEX_COLOR = 0;
+static const GLint FIXED_COLOR = 1;
+static const GLint CLASS_LABEL_COLOR = 2;
+
+static const char * POINT_VERTEX_SHADER =
+    "#version 120\n"
+    "attribute float label;\n"
+    "varying float point_label;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FrontColor = gl_Color;\n"
+    "    point_label = label;\n"
+    "    gl_Position = ftransform();\n"
+    "}\n";
+
+static const char * POINT_FRAGMENT_SHADER =
+    "#version 120\n"
+    "uniform int color_mode;\n"
+    "uniform vec3 fixed_color;\n"
+    "uniform sampler1D color_map;\n"
+    "uniform float color_map_size;\n"
+    "varying float point_label;\n"
+    "void main()\n"
+    "{\n"
+    "    if (color_mode == 1)\n"
+    "        gl_FragColor = vec4(fixed_color, 1.0);\n"
+    "    else if (color_mode == 2) {\n"
+    "        // points without semantic id are white\n"
+    "        if (point_label < 0.0)\n"
+    "            gl_FragColor = vec4(1.0);\n"
+    "        else if (point_label >= color_map_size)\n"
+    "            discard;\n"
+    "        else\n"
+    "            gl_FragColor = texture1D(color_map, (point_label + 0.5) / color_map_size);\n"
+    "    }\n"
+    "    else\n"
+    "        gl_FragColor = gl_Color;\n"
+    "}\n";
+
+bool point_shader::init()
+{
+    if (!gl::has_shaders()) {
+        LOG_WARNING("GLSL is not supported, points are not colored from their class label");
+        return false;
+    }
+    if (!m_program.build(POINT_VERTEX_SHADER, POINT_FRAGMENT_SHADER, {{POINT_LABEL_LOCATION, "label"}})) {
+        LOG_WARNING("Points are not colored from their class label");
+        return false;
+    }
+    m_mode_uniform = m_program.uniform("color_mode");
+    m_fixed_color_uniform = m_program.uniform("fixed_color");
+    m_color_map_size_uniform = m_program.uniform("color_map_size");
+    m_program.use();
+    gl::Uniform1i(m_program.uniform("color_map"), 0);
+    gl_program::unuse();
+    return true;
+}
+
+void point_shader::set_color_map(const std::vector<Vector3f> & colorMap)
+{
+    std::vector<unsigned char> texels(colorMap.size() * 3);
+    for (size_t i = 0; i < colorMap.size(); ++i) {
+        for (int c = 0; c < 3; ++c)
+            texels[3 * i + c] = static_cast<unsigned char>(std::min(std::max(colorMap[i][c], 0.f), 255.f));
+    }
+    m_color_map_size = colorMap.size();
+    if (m_color_map_size == 0)
+        return;
+
+    if (m_color_map == 0)
+        glGenTextures(1, &m_color_map);
+    glBindTexture(GL_TEXTURE_1D, m_color_map);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB8, static_cast<GLsizei>(m_color_map_size), 0, GL_RGB, GL_UNSIGNED_BYTE, texels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_1D, 0);
+}
+
+bool point_shader::use(const point_color_options & options) const
+{
+    // color of the points drawn without color array
+    glColor3fv(options.color);
+    if (!m_program.valid())
+        return !options.fixed_color || options.use_class_label;
+
+    GLint mode = options.use_class_label ? CLASS_LABEL_COLOR : options.fixed_color ? FIXED_COLOR : VERTEX_COLOR;
+    m_program.use();
+    gl::Uniform1i(m_mode_uniform, mode);
+    gl::Uniform3f(m_fixed_color_uniform, options.color[0], options.color[1], options.color[2]);
+    gl::Uniform1f(m_color_map_size_uniform, static_cast<float>(m_color_map_size));
+    glBindTexture(GL_TEXTURE_1D, m_color_map);
+    return true;
+}
+
+void point_shader::unuse() const
+{
+    if (!m_program.valid())
+        return;
+    glBindTexture(GL_TEXTURE_1D, 0);
+    gl_program::unuse();
+}
+
+void point_shader::release()
+{
+    if (m_color_map != 0)
+        glDeleteTextures(1, &m_color_map);
+    m_color_map = 0;
+    m_program.release();
+}
+
+}
+}
+}
@@ -0,0 +1,52 @@
+#ifndef _POINT_SHADER_H
+#define _POINT_SHADER_H
+
+#include <vector>
+
+#include "datastructure/MathDefinitions.h"
+
+#include "point_cloud_buffer.hpp"
+#include "src/glutils/gl_program.hpp"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+// Chooses the color of the points on the GPU, according to point_color_options
+// Points carry their own color and their semantic id, which is looked up in a color map texture, so changing
+// the color mode or the color map does not touch the vertex buffers. Points whose semantic id exceeds the
+// color map are not drawn. Without GLSL support, points are drawn with their own color or the fixed color.
+class point_shader {
+public:
+    point_shader() = default;
+    point_shader(const point_shader &) = delete;
+    point_shader & operator=(const point_shader &) = delete;
+
+    // build the shader, a context must be current
+    bool init();
+
+    // upload the class label colors in [0..255], a context must be current
+    void set_color_map(const std::vector<datastructure::Vector3f> & colorMap);
+
+    // set up the color of the next points drawn
+    // returns false if the color array of the points must not be bound
+    bool use(const point_color_options & options) const;
+    void unuse() const;
+
+    // free the GPU resources, a context must be current
+    void release();
+
+private:
+    gl_program m_program;
+    GLint m_mode_uniform = -1;
+    GLint m_fixed_color_uniform = -1;
+    GLint m_color_map_size_uniform = -1;
+    GLuint m_color_map = 0;
+    size_t m_color_map_size = 0;
+};
+
+}
+}
+}
+
+#endif
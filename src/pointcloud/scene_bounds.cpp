@@ -0,0 +1,127 @@
+#include "scene_bounds.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace SolAR {
+using namespace datastructure;
+namespace MODULES {
+namespace OPENGL {
+
+// hysteresis: relative center shift and size change required to update the scene bounds
+static const float CENTER_SHIFT_THRESHOLD = 0.1f;
+static const float SIZE_RATIO_THRESHOLD = 1.25f;
+
+void scene_samples::sample(const std::vector<point_vertex> & vertices)
+{
+    size_t step = (vertices.size() + MAX_SAMPLES - 1) / MAX_SAMPLES;
+    step = std::max<size_t>(step, 1);
+    size_t nbSamples = (vertices.size() + step - 1) / step;
+    x.resize(nbSamples);
+    y.resize(nbSamples);
+    z.resize(nbSamples);
+    for (size_t i = 0, j = 0; j < nbSamples; i += step, ++j) {
+        // back to the SolAR frame
+        x[j] = vertices[i].position[0];
+        y[j] = -vertices[i].position[1];
+        z[j] = -vertices[i].position[2];
+    }
+}
+
+void scene_samples::sample(const float * positions, size_t nbPoints)
+{
+    size_t step = (nbPoints + MAX_SAMPLES - 1) / MAX_SAMPLES;
+    step = std::max<size_t>(step, 1);
+    size_t nbSamples = (nbPoints + step - 1) / step;
+    x.resize(nbSamples);
+    y.resize(nbSamples);
+    z.resize(nbSamples);
+    for (size_t i = 0, j = 0; j < nbSamples; i += step, ++j) {
+        x[j] = positions[3 * i];
+        y[j] = positions[3 * i + 1];
+        z[j] = positions[3 * i + 2];
+    }
+}
+
+// median, 1% and 99% percentiles of the values in linear time
+static void select_percentiles(std::vector<float> & values, float & median, float & low, float & high)
+{
+    size_t n = values.size();
+    auto mid = values.begin() + n / 2;
+    std::nth_element(values.begin(), mid, values.end());
+    median = *mid;
+    // values before mid are lower or equal, values after are greater or equal
+    auto lowIt = values.begin() + static_cast<size_t>(n * 0.01);
+    std::nth_element(values.begin(), lowIt, mid);
+    low = *lowIt;
+    auto highIt = values.begin() + static_cast<size_t>(n * 0.99);
+    std::nth_element(mid, highIt, values.end());
+    high = *highIt;
+}
+
+bool scene_bounds_estimator::estimate(scene_samples & samples, scene_bounds & bounds)
+{
+    if (samples.empty())
+        return false;
+    Vector3f low, high;
+    select_percentiles(samples.x, bounds.center[0], low[0], high[0]);
+    select_percentiles(samples.y, bounds.center[1], low[1], high[1]);
+    select_percentiles(samples.z, bounds.center[2], low[2], high[2]);
+    bounds.size = (high - low).norm();
+    return true;
+}
+
+bool scene_bounds_estimator::submit(scene_samples && samples, bool asynchronous)
+{
+    if (busy())
+        return false;
+    if (!asynchronous) {
+        m_ready = estimate(samples, m_result);
+        return true;
+    }
+    m_pending = std::async(std::launch::async, [](scene_samples samples) {
+        scene_bounds bounds;
+        bool success = estimate(samples, bounds);
+        return std::make_pair(success, bounds);
+    }, std::move(samples));
+    return true;
+}
+
+bool scene_bounds_estimator::busy() const
+{
+    return m_pending.valid() && m_pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+}
+
+bool scene_bounds_estimator::poll(scene_bounds & bounds)
+{
+    if (m_pending.valid() && !busy()) {
+        auto result = m_pending.get();
+        m_ready = result.first;
+        m_result = result.second;
+    }
+    if (!m_ready)
+        return false;
+    bounds = m_result;
+    m_ready = false;
+    return true;
+}
+
+scene_bounds_estimator::~scene_bounds_estimator()
+{
+    if (m_pending.valid())
+        m_pending.wait();
+}
+
+bool scene_bounds_changed(const scene_bounds & reference, const scene_bounds & bounds)
+{
+    if (reference.size <= 0.f)
+        return bounds.size > 0.f;
+    if ((bounds.center - reference.center).norm() > CENTER_SHIFT_THRESHOLD * reference.size)
+        return true;
+    float ratio = bounds.size / reference.size;
+    return ratio > SIZE_RATIO_THRESHOLD || ratio < 1.f / SIZE_RATIO_THRESHOLD;
+}
+
+}
+}
+}
@@ -0,0 +1,63 @@
+#ifndef _SCENE_BOUNDS_H
+#define _SCENE_BOUNDS_H
+
+#include <future>
+#include <vector>
+
+#include "datastructure/MathDefinitions.h"
+
+#include "point_cloud_buffer.hpp"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+// robust center and size of a point cloud
+struct scene_bounds {
+    datastructure::Vector3f center = datastructure::Vector3f::Zero(); // median of each coordinate
+    float size = 0.f;                                    // diagonal of the 1% - 99% percentile box
+};
+
+// coordinates of a subset of the points of a cloud, at most MAX_SAMPLES points evenly spread over the cloud
+struct scene_samples {
+    static constexpr size_t MAX_SAMPLES = 1 << 16;
+
+    std::vector<float> x, y, z;
+
+    void sample(const std::vector<point_vertex> & vertices);   // positions in the OpenGL frame
+    void sample(const float * positions, size_t nbPoints);
+    bool empty() const { return x.empty(); }
+};
+
+// Estimates the scene bounds from point samples with a linear-time selection (std::nth_element)
+// The estimation can run on a worker thread, so that the caller never waits for it.
+class scene_bounds_estimator {
+public:
+    // compute the bounds of the samples, which are reordered
+    static bool estimate(scene_samples & samples, scene_bounds & bounds);
+
+    // estimate the bounds of the samples, on a worker thread if asynchronous
+    // returns false if the previous estimation is still running
+    bool submit(scene_samples && samples, bool asynchronous);
+
+    // get the result of the last estimation, returns false if no new result is available
+    bool poll(scene_bounds & bounds);
+
+    bool busy() const;
+
+    ~scene_bounds_estimator();
+
+private:
+    std::future<std::pair<bool, scene_bounds>> m_pending;
+    bool m_ready = false;
+    scene_bounds m_result;
+};
+
+// true if the bounds moved enough from the reference ones to be worth a view update
+bool scene_bounds_changed(const scene_bounds & reference, const scene_bounds & bounds);
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,88 @@
+#include "worker_pool.hpp"
+
+#include <algorithm>
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+// below this number of elements, a loop is not worth waking up the workers
+static const size_t PARALLEL_THRESHOLD = 16384;
+static const size_t PARALLEL_GRAIN = 4096;
+
+worker_pool::worker_pool(unsigned int nbThreads)
+{
+    if (nbThreads == 0)
+        nbThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int i = 1; i < nbThreads; ++i)
+        m_threads.emplace_back(&worker_pool::work, this);
+}
+
+worker_pool::~worker_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto & thread : m_threads)
+        thread.join();
+}
+
+void worker_pool::run_chunks()
+{
+    size_t begin;
+    while ((begin = m_next.fetch_add(m_grain)) < m_size)
+        (*m_task)(begin, std::min(m_size, begin + m_grain));
+}
+
+void worker_pool::work()
+{
+    uint64_t loop = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [&] { return m_stop || m_loop != loop; });
+        if (m_stop)
+            return;
+        loop = m_loop;
+        lock.unlock();
+        run_chunks();
+        lock.lock();
+        if (--m_running == 0)
+            m_done.notify_one();
+    }
+}
+
+void worker_pool::parallel_for(size_t n, size_t grain, const task & function)
+{
+    if (m_threads.empty() || n <= grain) {
+        function(0, n);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &function;
+        m_size = n;
+        m_grain = std::max<size_t>(grain, 1);
+        m_next = 0;
+        m_running = static_cast<unsigned int>(m_threads.size());
+        ++m_loop;
+    }
+    m_wake.notify_all();
+    run_chunks();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&] { return m_running == 0; });
+    m_task = nullptr;
+}
+
+void parallel_for(worker_pool * pool, size_t n, const worker_pool::task & function)
+{
+    if (pool != nullptr && n >= PARALLEL_THRESHOLD)
+        pool->parallel_for(n, PARALLEL_GRAIN, function);
+    else
+        function(0, n);
+}
+
+}
+}
+}
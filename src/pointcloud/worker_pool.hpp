@@ -0,0 +1,60 @@
+#ifndef _WORKER_POOL_H
+#define _WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+// Persistent threads running chunks of a loop together with the calling thread
+class worker_pool {
+public:
+    typedef std::function<void(size_t begin, size_t end)> task;
+
+    // nbThreads: total number of threads including the calling one, 0 for the number of hardware threads
+    explicit worker_pool(unsigned int nbThreads = 0);
+    ~worker_pool();
+
+    worker_pool(const worker_pool &) = delete;
+    worker_pool & operator=(const worker_pool &) = delete;
+
+    // number of threads running a loop, including the calling one
+    unsigned int size() const { return static_cast<unsigned int>(m_threads.size()) + 1; }
+
+    // run task on chunks of at most grain elements of [0, n), returns once all chunks are done
+    // a pool runs one loop at a time, it must not be shared between concurrent callers
+    void parallel_for(size_t n, size_t grain, const task & function);
+
+private:
+    void work();
+    void run_chunks();
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+
+    const task * m_task = nullptr;
+    size_t m_size = 0;
+    size_t m_grain = 1;
+    std::atomic<size_t> m_next{0};
+    unsigned int m_running = 0;                           // workers still busy on the current loop
+    uint64_t m_loop = 0;                                  // incremented for each loop
+    bool m_stop = false;
+};
+
+// run function on [0, n), in parallel on pool if given and if n is large enough
+void parallel_for(worker_pool * pool, size_t n, const worker_pool::task & function);
+
+}
+}
+}
+
+#endif
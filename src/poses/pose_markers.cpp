@@ -0,0 +1,253 @@
+#include "pose_markers.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "core/Log.h"
+
+namespace SolAR {
+using namespace datastructure;
+namespace MODULES {
+namespace OPENGL {
+
+// first location of the 4 columns of the instance matrix
+static const GLuint INSTANCE_POSE_LOCATION = 4;
+
+static const char * INSTANCE_VERTEX_SHADER =
+    "#version 120\n"
+    "attribute mat4 instance_pose;\n"
+    "uniform float scale;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FrontColor = gl_Color;\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * (instance_pose * vec4(gl_Vertex.xyz * scale, 1.0));\n"
+    "}\n";
+
+static const char * INSTANCE_FRAGMENT_SHADER =
+    "#version 120\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = gl_Color;\n"
+    "}\n";
+
+static const float PI = 3.14159265358979f;
+// radius of the unit meshes around the pose center
+static const float SPHERE_RADIUS = 1.f;
+static const float FRUSTUM_RADIUS = 2.45f;
+static const int SPHERE_SLICES = 12;
+static const int SPHERE_STACKS = 8;
+
+static void add_vertex(std::vector<float> & vertices, float x, float y, float z)
+{
+    vertices.push_back(x);
+    vertices.push_back(y);
+    vertices.push_back(z);
+}
+
+// unit sphere as a list of triangles
+static void build_sphere(std::vector<float> & vertices)
+{
+    auto point = [](int slice, int stack, float * p) {
+        float theta = 2.f * PI * slice / SPHERE_SLICES;
+        float phi = PI * stack / SPHERE_STACKS;
+        p[0] = std::sin(phi) * std::cos(theta);
+        p[1] = std::sin(phi) * std::sin(theta);
+        p[2] = std::cos(phi);
+    };
+    float p[4][3];
+    for (int stack = 0; stack < SPHERE_STACKS; ++stack) {
+        for (int slice = 0; slice < SPHERE_SLICES; ++slice) {
+            point(slice, stack, p[0]);
+            point(slice + 1, stack, p[1]);
+            point(slice + 1, stack + 1, p[2]);
+            point(slice, stack + 1, p[3]);
+            for (int i : {0, 1, 2, 0, 2, 3})
+                add_vertex(vertices, p[i][0], p[i][1], p[i][2]);
+        }
+    }
+}
+
+// camera frustum of unit scale as a list of lines, in the camera frame
+static void build_frustum(std::vector<float> & vertices)
+{
+    const float corners[4][3] = {{1.f, 1.f, 2.f}, {-1.f, 1.f, 2.f}, {-1.f, -1.f, 2.f}, {1.f, -1.f, 2.f}};
+    for (int i = 0; i < 4; ++i) {
+        // line from the optical center to each corner
+        add_vertex(vertices, 0.f, 0.f, 0.f);
+        add_vertex(vertices, corners[i][0], corners[i][1], corners[i][2]);
+        // image plane border
+        const float * next = corners[(i + 1) % 4];
+        add_vertex(vertices, corners[i][0], corners[i][1], corners[i][2]);
+        add_vertex(vertices, next[0], next[1], next[2]);
+    }
+}
+
+static const Transform3Df SolAR2GL = [] {
+  Eigen::Matrix<float, 4, 4> matrix;
+  matrix << 1.0, 0.0, 0.0, 0.0, 0.0, -1.0, 0.0, 0.0, 0.0, 0.0, -1.0, 0.0, 0.0, 0.0, 0.0, 1.0;
+  return Transform3Df(matrix);
+}();
+
+void pose_instances::set_poses(const std::vector<Transform3Df> & poses, bool orientation)
+{
+    m_matrices.resize(poses.size() * 16);
+    for (size_t i = 0; i < poses.size(); ++i) {
+        Eigen::Map<Eigen::Matrix4f> matrix(&m_matrices[16 * i]);
+        matrix = (SolAR2GL * poses[i]).matrix();
+        if (!orientation)
+            matrix.topLeftCorner<3, 3>().setIdentity();
+    }
+
+    m_chunks.resize((poses.size() + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    for (size_t i = 0; i < m_chunks.size(); ++i) {
+        chunk & bounds = m_chunks[i];
+        bounds.low = Vector3f::Constant(std::numeric_limits<float>::max());
+        bounds.high = Vector3f::Constant(std::numeric_limits<float>::lowest());
+        size_t end = std::min(poses.size(), (i + 1) * CHUNK_SIZE);
+        for (size_t j = i * CHUNK_SIZE; j < end; ++j) {
+            Eigen::Map<const Vector3f> position(&m_matrices[16 * j + 12]);
+            bounds.low = bounds.low.cwiseMin(position);
+            bounds.high = bounds.high.cwiseMax(position);
+        }
+    }
+    m_dirty = true;
+}
+
+void pose_instances::upload()
+{
+    if (!m_dirty)
+        return;
+    if (m_vbo == 0)
+        gl::GenBuffers(1, &m_vbo);
+    gl::BindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    size_t bytes = m_matrices.size() * sizeof(float);
+    if (bytes > m_gpu_capacity) {
+        m_gpu_capacity = bytes + bytes / 2;
+        gl::BufferData(GL_ARRAY_BUFFER, m_gpu_capacity, nullptr, GL_DYNAMIC_DRAW);
+    }
+    if (bytes > 0)
+        gl::BufferSubData(GL_ARRAY_BUFFER, 0, bytes, m_matrices.data());
+    gl::BindBuffer(GL_ARRAY_BUFFER, 0);
+    m_dirty = false;
+}
+
+void pose_instances::release()
+{
+    if (m_vbo != 0)
+        gl::DeleteBuffers(1, &m_vbo);
+    m_vbo = 0;
+    m_gpu_capacity = 0;
+    m_dirty = !m_matrices.empty();
+}
+
+bool pose_markers::init()
+{
+    std::vector<float> vertices;
+    build_sphere(vertices);
+    m_sphere_first = 0;
+    m_sphere_count = static_cast<GLint>(vertices.size() / 3);
+    build_frustum(vertices);
+    m_frustum_first = m_sphere_count;
+    m_frustum_count = static_cast<GLint>(vertices.size() / 3) - m_sphere_count;
+
+    if (m_mesh_vbo == 0)
+        gl::GenBuffers(1, &m_mesh_vbo);
+    gl::BindBuffer(GL_ARRAY_BUFFER, m_mesh_vbo);
+    gl::BufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    gl::BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (gl::has_instancing()) {
+        if (m_program.build(INSTANCE_VERTEX_SHADER, INSTANCE_FRAGMENT_SHADER, {{INSTANCE_POSE_LOCATION, "instance_pose"}}))
+            m_scale_uniform = m_program.uniform("scale");
+        else
+            LOG_WARNING("Pose markers are drawn without instancing");
+    }
+    return true;
+}
+
+size_t pose_markers::draw(shape marker, pose_instances & instances, float scale, const gl_view & view) const
+{
+    if (instances.empty())
+        return 0;
+    GLenum mode = marker == SPHERE ? GL_TRIANGLES : GL_LINES;
+    GLint first = marker == SPHERE ? m_sphere_first : m_frustum_first;
+    GLint count = marker == SPHERE ? m_sphere_count : m_frustum_count;
+    Vector3f margin = Vector3f::Constant((marker == SPHERE ? SPHERE_RADIUS : FRUSTUM_RADIUS) * scale);
+
+    gl::BindBuffer(GL_ARRAY_BUFFER, m_mesh_vbo);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, nullptr);
+    if (m_program.valid()) {
+        instances.upload();
+        m_program.use();
+        gl::Uniform1f(m_scale_uniform, scale);
+    }
+
+    // draw each run of consecutive visible chunks at once
+    size_t nbDrawn = 0;
+    const std::vector<pose_instances::chunk> & chunks = instances.chunks();
+    size_t runBegin = 0;
+    for (size_t i = 0; i <= chunks.size(); ++i) {
+        if (i < chunks.size() && view.sees(chunks[i].low - margin, chunks[i].high + margin))
+            continue;
+        size_t begin = runBegin * pose_instances::CHUNK_SIZE;
+        size_t end = std::min(instances.size(), i * pose_instances::CHUNK_SIZE);
+        if (end > begin) {
+            draw_range(mode, first, count, instances, begin, end, scale);
+            nbDrawn += end - begin;
+        }
+        runBegin = i + 1;
+    }
+
+    if (m_program.valid())
+        gl_program::unuse();
+    glDisableClientState(GL_VERTEX_ARRAY);
+    gl::BindBuffer(GL_ARRAY_BUFFER, 0);
+    return nbDrawn;
+}
+
+void pose_markers::draw_range(GLenum mode, GLint first, GLint count, const pose_instances & instances,
+                              size_t begin, size_t end, float scale) const
+{
+    if (m_program.valid()) {
+        // the instance attributes start at the first pose of the range
+        gl::BindBuffer(GL_ARRAY_BUFFER, instances.buffer());
+        for (GLuint column = 0; column < 4; ++column) {
+            GLuint location = INSTANCE_POSE_LOCATION + column;
+            gl::EnableVertexAttribArray(location);
+            gl::VertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float),
+                                    reinterpret_cast<const void *>((16 * begin + 4 * column) * sizeof(float)));
+            gl::VertexAttribDivisor(location, 1);
+        }
+        gl::DrawArraysInstanced(mode, first, count, static_cast<GLsizei>(end - begin));
+        for (GLuint column = 0; column < 4; ++column) {
+            gl::VertexAttribDivisor(INSTANCE_POSE_LOCATION + column, 0);
+            gl::DisableVertexAttribArray(INSTANCE_POSE_LOCATION + column);
+        }
+        gl::BindBuffer(GL_ARRAY_BUFFER, m_mesh_vbo);
+    }
+    else {
+        const std::vector<float> & matrices = instances.matrices();
+        glMatrixMode(GL_MODELVIEW);
+        for (size_t i = begin; i < end; ++i) {
+            glPushMatrix();
+            glMultMatrixf(&matrices[16 * i]);
+            glScalef(scale, scale, scale);
+            glDrawArrays(mode, first, count);
+            glPopMatrix();
+        }
+    }
+}
+
+void pose_markers::release()
+{
+    if (m_mesh_vbo != 0)
+        gl::DeleteBuffers(1, &m_mesh_vbo);
+    m_mesh_vbo = 0;
+    m_program.release();
+}
+
+}
+}
+}
@@ -0,0 +1,92 @@
+#ifndef _POSE_MARKERS_H
+#define _POSE_MARKERS_H
+
+#include <vector>
+
+#include "datastructure/MathDefinitions.h"
+
+#include "src/glutils/gl_program.hpp"
+#include "src/glutils/gl_view.hpp"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+// OpenGL transforms (column major 4x4 matrices) of a set of poses, uploaded to an instance buffer
+// Consecutive poses are grouped in chunks bounded by the box of their positions, to be culled against the view.
+class pose_instances {
+public:
+    static const size_t CHUNK_SIZE = 64;
+
+    // bounds of the positions of poses [first, first + CHUNK_SIZE)
+    struct chunk {
+        datastructure::Vector3f low;
+        datastructure::Vector3f high;
+    };
+
+    pose_instances() = default;
+    pose_instances(const pose_instances &) = delete;
+    pose_instances & operator=(const pose_instances &) = delete;
+
+    // convert the poses to the OpenGL frame, orientation is dropped if not required (e.g. spheres)
+    // the upload is deferred to the next draw
+    void set_poses(const std::vector<datastructure::Transform3Df> & poses, bool orientation);
+
+    // upload the transforms if they changed, a context must be current
+    void upload();
+    bool upload_pending() const { return m_dirty; }
+
+    GLuint buffer() const { return m_vbo; }
+    const std::vector<float> & matrices() const { return m_matrices; }
+    const std::vector<chunk> & chunks() const { return m_chunks; }
+    size_t size() const { return m_matrices.size() / 16; }
+    bool empty() const { return m_matrices.empty(); }
+
+    // free the GPU buffer, a context must be current
+    void release();
+
+private:
+    std::vector<float> m_matrices;
+    std::vector<chunk> m_chunks;
+    GLuint m_vbo = 0;
+    size_t m_gpu_capacity = 0;
+    bool m_dirty = false;
+};
+
+// Draws a marker mesh (sphere or camera frustum) for each pose of a set with a single instanced draw call
+// Without instancing support, the mesh is drawn once per pose.
+class pose_markers {
+public:
+    enum shape { SPHERE, FRUSTUM };
+
+    pose_markers() = default;
+    pose_markers(const pose_markers &) = delete;
+    pose_markers & operator=(const pose_markers &) = delete;
+
+    // build the meshes and the shader, a context must be current
+    bool init();
+
+    // draw the marker at each pose with the current color (glColor), scaled by scale
+    // frustums are drawn with lines of the current width, chunks of poses outside of the view are skipped
+    // returns the number of markers drawn
+    size_t draw(shape marker, pose_instances & instances, float scale, const gl_view & view = gl_view()) const;
+
+    // free the GPU resources, a context must be current
+    void release();
+
+private:
+    GLuint m_mesh_vbo = 0;
+    GLint m_sphere_first = 0, m_sphere_count = 0;
+    GLint m_frustum_first = 0, m_frustum_count = 0;
+    void draw_range(GLenum mode, GLint first, GLint count, const pose_instances & instances,
+                    size_t begin, size_t end, float scale) const;
+
+    gl_program m_program;
+    GLint m_scale_uniform = -1;
+};
+
+}
+}
+}
+
+#endif
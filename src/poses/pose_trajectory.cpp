@@ -0,0 +1,124 @@
+#include "pose_trajectory.hpp"
+
+#include <algorithm>
+
+namespace SolAR {
+using namespace datastructure;
+namespace MODULES {
+namespace OPENGL {
+
+// minimum number of positions allocated in the GPU buffer
+static const size_t MIN_GPU_CAPACITY = 1024;
+
+// position of a pose in the OpenGL frame
+static void gl_position(const Transform3Df & pose, float * position)
+{
+    position[0] = pose(0, 3);
+    position[1] = -pose(1, 3);
+    position[2] = -pose(2, 3);
+}
+
+// index of the first known position which is not the one of its pose, or the number of poses kept
+size_t pose_trajectory::first_change(const std::vector<Transform3Df> & poses) const
+{
+    size_t known = std::min(size(), poses.size());
+    for (size_t i = 0; i < known; ++i) {
+        float position[3];
+        gl_position(poses[i], position);
+        if (!std::equal(position, position + 3, m_positions.begin() + 3 * i))
+            return i;
+    }
+    return known;
+}
+
+void pose_trajectory::set_poses(const std::vector<Transform3Df> & poses)
+{
+    size_t begin = first_change(poses);
+    m_positions.resize(3 * poses.size());
+    for (size_t i = begin; i < poses.size(); ++i)
+        gl_position(poses[i], &m_positions[3 * i]);
+    m_uploaded = std::min(m_uploaded, begin);
+}
+
+void pose_trajectory::upload()
+{
+    size_t nb_positions = size();
+    if (m_uploaded == nb_positions)
+        return;
+    if (m_vbo == 0)
+        gl::GenBuffers(1, &m_vbo);
+    gl::BindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    if (nb_positions > m_gpu_capacity) {
+        // grow geometrically so that the whole trajectory is only sent again a logarithmic number of times
+        m_gpu_capacity = std::max(MIN_GPU_CAPACITY, 2 * nb_positions);
+        gl::BufferData(GL_ARRAY_BUFFER, m_gpu_capacity * 3 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+        m_uploaded = 0;
+    }
+    gl::BufferSubData(GL_ARRAY_BUFFER, m_uploaded * 3 * sizeof(float), (nb_positions - m_uploaded) * 3 * sizeof(float),
+                      &m_positions[3 * m_uploaded]);
+    gl::BindBuffer(GL_ARRAY_BUFFER, 0);
+    m_uploaded = nb_positions;
+}
+
+void pose_trajectory::upload_markers(unsigned int marker_step)
+{
+    // the indices only depend on the step, they are kept while the trajectory shrinks
+    if (marker_step != m_marker_step) {
+        m_marker_step = marker_step;
+        m_markers.clear();
+        m_markers_uploaded = 0;
+    }
+    for (size_t i = m_markers.empty() ? 0 : m_markers.back() + marker_step; i < size(); i += marker_step)
+        m_markers.push_back(static_cast<uint32_t>(i));
+    if (m_marker_ebo == 0)
+        gl::GenBuffers(1, &m_marker_ebo);
+    gl::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_marker_ebo);
+    if (m_markers.size() > m_marker_capacity) {
+        m_marker_capacity = std::max(MIN_GPU_CAPACITY, 2 * m_markers.size());
+        gl::BufferData(GL_ELEMENT_ARRAY_BUFFER, m_marker_capacity * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+        m_markers_uploaded = 0;
+    }
+    if (m_markers_uploaded < m_markers.size())
+        gl::BufferSubData(GL_ELEMENT_ARRAY_BUFFER, m_markers_uploaded * sizeof(uint32_t),
+                          (m_markers.size() - m_markers_uploaded) * sizeof(uint32_t), &m_markers[m_markers_uploaded]);
+    m_markers_uploaded = m_markers.size();
+}
+
+void pose_trajectory::draw(unsigned int marker_step, float marker_size)
+{
+    upload();
+    GLsizei nb_positions = static_cast<GLsizei>(size());
+    if (nb_positions == 0)
+        return;
+    gl::BindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, nullptr);
+    glDrawArrays(GL_LINE_STRIP, 0, nb_positions);
+    if (marker_step > 0) {
+        // markers index every marker_step position of the same buffer
+        upload_markers(marker_step);
+        glPointSize(marker_size);
+        glDrawElements(GL_POINTS, (nb_positions + marker_step - 1) / marker_step, GL_UNSIGNED_INT, nullptr);
+        gl::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+    glDisableClientState(GL_VERTEX_ARRAY);
+    gl::BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void pose_trajectory::release()
+{
+    if (m_vbo != 0)
+        gl::DeleteBuffers(1, &m_vbo);
+    if (m_marker_ebo != 0)
+        gl::DeleteBuffers(1, &m_marker_ebo);
+    m_vbo = 0;
+    m_gpu_capacity = 0;
+    m_uploaded = 0;
+    m_marker_ebo = 0;
+    m_marker_capacity = 0;
+    m_markers_uploaded = 0;
+}
+
+}
+}
+}
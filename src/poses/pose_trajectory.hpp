@@ -0,0 +1,62 @@
+#ifndef _POSE_TRAJECTORY_H
+#define _POSE_TRAJECTORY_H
+
+#include <vector>
+
+#include "datastructure/MathDefinitions.h"
+
+#include "src/glutils/gl_functions.hpp"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+// Positions of a growing set of poses (e.g. the frames of a session), drawn as a single line strip
+// The positions are kept in a vertex buffer filled from its end: every known pose is compared to its position, and
+// the trajectory is converted and uploaded again from the first one that moved (e.g. after a loop closure or a local
+// correction), so that when the poses only extend the previous ones, only the new tail is sent.
+class pose_trajectory {
+public:
+    pose_trajectory() = default;
+    pose_trajectory(const pose_trajectory &) = delete;
+    pose_trajectory & operator=(const pose_trajectory &) = delete;
+
+    // convert the new positions to the OpenGL frame, the upload is deferred to the next draw
+    void set_poses(const std::vector<datastructure::Transform3Df> & poses);
+
+    // upload the positions not yet in the GPU buffer, a context must be current
+    void upload();
+    bool upload_pending() const { return m_uploaded != size(); }
+
+    // draw the trajectory with the current color and line width
+    // if marker_step is not 0, a point of marker_size pixels is drawn every marker_step poses
+    void draw(unsigned int marker_step, float marker_size);
+
+    size_t size() const { return m_positions.size() / 3; }
+    bool empty() const { return m_positions.empty(); }
+
+    // free the GPU buffer, a context must be current
+    void release();
+
+private:
+    size_t first_change(const std::vector<datastructure::Transform3Df> & poses) const;
+    void upload_markers(unsigned int marker_step);
+
+    std::vector<float> m_positions;                       // in the OpenGL frame
+    size_t m_uploaded = 0;                                // positions already in the GPU buffer
+    GLuint m_vbo = 0;
+    size_t m_gpu_capacity = 0;                            // in positions
+
+    // markers are drawn through indices rather than a stride, which may exceed the maximum vertex attribute stride
+    std::vector<uint32_t> m_markers;                      // every marker_step position, up to the longest trajectory
+    unsigned int m_marker_step = 0;
+    size_t m_markers_uploaded = 0;
+    GLuint m_marker_ebo = 0;
+    size_t m_marker_capacity = 0;                         // in indices
+};
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,87 @@
+#include "image_pool.hpp"
+
+#include <algorithm>
+#include <memory>
+
+namespace SolAR {
+using namespace datastructure;
+namespace MODULES {
+namespace OPENGL {
+
+bool image_pool::same_format(const Image & image1, const Image & image2)
+{
+    return image1.getWidth() == image2.getWidth() && image1.getHeight() == image2.getHeight() &&
+           image1.getImageLayout() == image2.getImageLayout() && image1.getPixelOrder() == image2.getPixelOrder() &&
+           image1.getDataType() == image2.getDataType() && image1.getBufferSize() == image2.getBufferSize();
+}
+
+void image_pool::set_capacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_capacity = capacity;
+    while (m_free.size() > m_capacity) {
+        m_free.pop_front();
+        ++m_counters.evicted;
+    }
+}
+
+SRef<Image> image_pool::acquire(const Image & model)
+{
+    SRef<Image> image;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_counters.acquired;
+        m_counters.high_water = std::max(m_counters.high_water, ++m_in_use);
+        // the most recently released images first
+        auto found = std::find_if(m_free.rbegin(), m_free.rend(), [&model](const SRef<Image> & free) {
+            return same_format(*free, model);
+        });
+        if (found != m_free.rend()) {
+            image = std::move(*found);
+            m_free.erase(std::next(found).base());
+            return image;
+        }
+        ++m_counters.misses;
+    }
+    // allocated out of the lock
+    image = std::make_shared<Image>(model.getWidth(), model.getHeight(), model.getImageLayout(),
+                                    model.getPixelOrder(), model.getDataType());
+    if (image->getBufferSize() != model.getBufferSize())
+        // rows of the model are padded
+        image = model.copy();
+    return image;
+}
+
+void image_pool::release(SRef<Image> && image)
+{
+    if (!image)
+        return;
+    // an evicted image is freed out of the lock
+    SRef<Image> evicted;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_in_use > 0)
+        --m_in_use;
+    if (m_capacity == 0) {
+        ++m_counters.evicted;
+        evicted = std::move(image);
+        return;
+    }
+    if (m_free.size() >= m_capacity) {
+        evicted = std::move(m_free.front());
+        m_free.pop_front();
+        ++m_counters.evicted;
+    }
+    m_free.push_back(std::move(image));
+}
+
+image_pool_counters image_pool::counters() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    image_pool_counters counters = m_counters;
+    counters.available = m_free.size();
+    return counters;
+}
+
+}
+}
+}
@@ -0,0 +1,60 @@
+#ifndef _IMAGE_POOL_H
+#define _IMAGE_POOL_H
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+#include "datastructure/Image.h"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+// images taken from the pool (acquired), allocated because no free image matched (misses), released images
+// freed because the pool was full (evicted), free images in the pool (available) and maximum number of images
+// acquired and not yet released at once (high_water)
+struct image_pool_counters {
+    uint64_t acquired = 0;
+    uint64_t misses = 0;
+    uint64_t evicted = 0;
+    size_t available = 0;
+    size_t high_water = 0;
+};
+
+// Recycles the buffers of images, keyed by their width, height, layout, pixel order and data type
+// Images are acquired and released from any thread. Once full, the pool frees its oldest free image to keep a
+// released one, so that its free images follow the format in use.
+class image_pool {
+public:
+    image_pool() = default;
+    image_pool(const image_pool &) = delete;
+    image_pool & operator=(const image_pool &) = delete;
+
+    // maximum number of free images kept (0 to free each released image)
+    void set_capacity(size_t capacity);
+
+    // free image with the format of model, allocated if none matches, its content is undefined
+    SRef<datastructure::Image> acquire(const datastructure::Image & model);
+
+    // give back an acquired image, no longer used by anyone else
+    void release(SRef<datastructure::Image> && image);
+
+    image_pool_counters counters() const;
+
+    // true if an image can be copied into the other one
+    static bool same_format(const datastructure::Image & image1, const datastructure::Image & image2);
+
+private:
+    std::deque<SRef<datastructure::Image>> m_free;        // from the oldest to the most recently released
+    size_t m_capacity = 0;
+    size_t m_in_use = 0;
+    image_pool_counters m_counters;
+    mutable std::mutex m_mutex;
+};
+
+}
+}
+}
+
+#endif
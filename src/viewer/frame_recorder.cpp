@@ -0,0 +1,225 @@
+#include "frame_recorder.hpp"
+
+#include <algorithm>
+
+#include "core/Log.h"
+
+namespace SolAR {
+using namespace datastructure;
+namespace MODULES {
+namespace OPENGL {
+
+bool frame_recorder::parse_policy(const std::string & name, drop_policy & policy)
+{
+    if (name == "newest")
+        policy = DROP_NEWEST;
+    else if (name == "oldest")
+        policy = DROP_OLDEST;
+    else if (name == "block")
+        policy = BLOCK;
+    else
+        return false;
+    return true;
+}
+
+bool frame_recorder::valid_pattern(const std::string & path)
+{
+    // %% escapes, and a single %d with an optional zero padding and width, which must fit in the name buffer
+    int conversions = 0;
+    for (size_t i = 0; i < path.size(); ++i) {
+        if (path[i] != '%')
+            continue;
+        if (++i < path.size() && path[i] == '%')
+            continue;
+        if (i < path.size() && path[i] == '0')
+            ++i;
+        int width = 0;
+        while (i < path.size() && path[i] >= '0' && path[i] <= '9' && width <= MAX_INDEX_WIDTH)
+            width = 10 * width + (path[i++] - '0');
+        if (i >= path.size() || path[i] != 'd' || width > MAX_INDEX_WIDTH)
+            return false;
+        ++conversions;
+    }
+    return conversions == 1;
+}
+
+bool frame_recorder::open(const std::string & path, size_t queueSize, drop_policy policy, unsigned int frameRate)
+{
+    close();
+    m_path = path;
+    m_y4m = path.size() >= 4 && path.compare(path.size() - 4, 4, ".y4m") == 0;
+    m_queue_size = std::max(queueSize, size_t(1));
+    m_policy = policy;
+    m_frame_rate = std::max(frameRate, 1u);
+    m_counters = frame_recorder_counters();
+    m_width = m_height = 0;
+    m_index = 0;
+    m_size_warned = false;
+    if (!m_y4m && !valid_pattern(path)) {
+        LOG_ERROR("The frame files pattern {} must have a single %d conversion for the frame number (e.g. frame_%06d.ppm)", path);
+        return false;
+    }
+    if (m_y4m) {
+        m_file = std::fopen(path.c_str(), "wb");
+        if (m_file == nullptr) {
+            LOG_ERROR("Failed to create the video file {}", path);
+            return false;
+        }
+    }
+    m_stop = false;
+    m_writer = std::thread(&frame_recorder::write_frames, this);
+    return true;
+}
+
+void frame_recorder::submit(const SRef<Image> & frame)
+{
+    if (!frame || !is_open())
+        return;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    ++m_counters.submitted;
+    if (m_queue.size() >= m_queue_size) {
+        if (m_policy == BLOCK)
+            m_dequeued.wait(lock, [this] { return m_queue.size() < m_queue_size; });
+        else if (m_policy == DROP_OLDEST) {
+            m_queue.pop_front();
+            ++m_counters.dropped;
+        }
+        else {
+            ++m_counters.dropped;
+            return;
+        }
+    }
+    m_queue.push_back(frame);
+    m_queued.notify_one();
+}
+
+void frame_recorder::close()
+{
+    if (!is_open())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_queued.notify_one();
+    m_writer.join();
+    if (m_file != nullptr)
+        std::fclose(m_file);
+    m_file = nullptr;
+    LOG_INFO("Recorded {} frames to {}, {} dropped", m_counters.written, m_path, m_counters.dropped);
+}
+
+frame_recorder_counters frame_recorder::counters() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_counters;
+}
+
+void frame_recorder::write_frames()
+{
+    while (true) {
+        SRef<Image> frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            // the queue is flushed before stopping
+            m_queued.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if (m_queue.empty())
+                return;
+            frame = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        m_dequeued.notify_one();
+        bool written = write(*frame);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (written)
+            ++m_counters.written;
+        else
+            ++m_counters.dropped;
+    }
+}
+
+bool frame_recorder::write(const Image & frame)
+{
+    if (frame.getImageLayout() != Image::LAYOUT_BGR || frame.getDataType() != Image::TYPE_8U)
+        return false;
+    return m_y4m ? write_y4m(frame) : write_ppm(frame);
+}
+
+bool frame_recorder::write_y4m(const Image & frame)
+{
+    uint32_t width = frame.getWidth(), height = frame.getHeight();
+    if (m_width == 0) {
+        m_width = width;
+        m_height = height;
+        std::fprintf(m_file, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", width, height, m_frame_rate);
+    }
+    else if (width != m_width || height != m_height) {
+        if (!m_size_warned)
+            LOG_WARNING("Frames of {}x{} are dropped, the video {} is recorded at {}x{}", width, height, m_path, m_width, m_height);
+        m_size_warned = true;
+        return false;
+    }
+
+    // BGR to BT.601 YCbCr, chroma averaged on 2x2 blocks
+    uint32_t chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    size_t lumaSize = size_t(width) * height, chromaSize = size_t(chromaWidth) * chromaHeight;
+    m_planes.assign(lumaSize + 2 * chromaSize, 0);
+    unsigned char * luma = m_planes.data();
+    unsigned char * cb = luma + lumaSize;
+    unsigned char * cr = cb + chromaSize;
+    const unsigned char * pixels = static_cast<const unsigned char *>(frame.data());
+    for (uint32_t cy = 0; cy < chromaHeight; ++cy) {
+        for (uint32_t cx = 0; cx < chromaWidth; ++cx) {
+            int sumB = 0, sumG = 0, sumR = 0, count = 0;
+            for (uint32_t y = 2 * cy; y < std::min(2 * cy + 2, height); ++y) {
+                for (uint32_t x = 2 * cx; x < std::min(2 * cx + 2, width); ++x) {
+                    const unsigned char * bgr = pixels + (size_t(y) * width + x) * 3;
+                    luma[size_t(y) * width + x] = static_cast<unsigned char>(((66 * bgr[2] + 129 * bgr[1] + 25 * bgr[0] + 128) >> 8) + 16);
+                    sumB += bgr[0];
+                    sumG += bgr[1];
+                    sumR += bgr[2];
+                    ++count;
+                }
+            }
+            int b = sumB / count, g = sumG / count, r = sumR / count;
+            cb[size_t(cy) * chromaWidth + cx] = static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            cr[size_t(cy) * chromaWidth + cx] = static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+    ++m_index;
+    return std::fputs("FRAME\n", m_file) >= 0 && std::fwrite(m_planes.data(), 1, m_planes.size(), m_file) == m_planes.size();
+}
+
+bool frame_recorder::write_ppm(const Image & frame)
+{
+    // the pattern was checked by open
+    std::vector<char> name(m_path.size() + MAX_INDEX_WIDTH + 12);
+    std::snprintf(name.data(), name.size(), m_path.c_str(), static_cast<int>(m_index++));
+    FILE * file = std::fopen(name.data(), "wb");
+    if (file == nullptr) {
+        LOG_WARNING("Failed to create the frame file {}", name.data());
+        return false;
+    }
+    // PPM pixels are RGB
+    uint32_t width = frame.getWidth(), height = frame.getHeight();
+    std::fprintf(file, "P6\n%u %u\n255\n", width, height);
+    size_t rowSize = size_t(width) * 3;
+    m_planes.resize(rowSize);
+    const unsigned char * pixels = static_cast<const unsigned char *>(frame.data());
+    bool success = true;
+    for (uint32_t y = 0; y < height && success; ++y) {
+        const unsigned char * bgr = pixels + y * rowSize;
+        for (size_t x = 0; x < rowSize; x += 3) {
+            m_planes[x] = bgr[x + 2];
+            m_planes[x + 1] = bgr[x + 1];
+            m_planes[x + 2] = bgr[x];
+        }
+        success = std::fwrite(m_planes.data(), 1, rowSize, file) == rowSize;
+    }
+    std::fclose(file);
+    return success;
+}
+
+}
+}
+}
@@ -0,0 +1,100 @@
+#ifndef _FRAME_RECORDER_H
+#define _FRAME_RECORDER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "datastructure/Image.h"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+// number of frames given to record (submitted), written to disk (written) and dropped
+struct frame_recorder_counters {
+    uint64_t submitted = 0;
+    uint64_t written = 0;
+    uint64_t dropped = 0;
+};
+
+// Writes BGR frames to disk on a background thread, through a bounded queue
+// A path ending with .y4m is a YUV4MPEG2 video (4:2:0), any other path is a printf pattern of binary PPM files
+// with a single %d conversion for the frame number, from 0 (e.g. frames/frame_%06d.ppm).
+class frame_recorder {
+public:
+    // what submit does when the queue is full
+    enum drop_policy {
+        DROP_NEWEST,                                      // the submitted frame is dropped
+        DROP_OLDEST,                                      // the oldest queued frame is dropped
+        BLOCK                                             // the caller waits for the writer, nothing is dropped
+    };
+
+    // maximum width of the frame number in the name of the frame files
+    static constexpr int MAX_INDEX_WIDTH = 20;
+
+    frame_recorder() = default;
+    frame_recorder(const frame_recorder &) = delete;
+    frame_recorder & operator=(const frame_recorder &) = delete;
+    ~frame_recorder() { close(); }
+
+    // parse a drop policy name (newest, oldest or block), returns false if unknown
+    static bool parse_policy(const std::string & name, drop_policy & policy);
+
+    // true if path has exactly one %d conversion, with an optional zero padding and a width up to MAX_INDEX_WIDTH,
+    // any other % being escaped as %%
+    static bool valid_pattern(const std::string & path);
+
+    // start the writer thread, the Y4M header is written with the size of the first frame
+    // returns false if the video file can not be created or if the pattern of the frame files is not valid
+    bool open(const std::string & path, size_t queueSize, drop_policy policy, unsigned int frameRate);
+
+    // queue a frame to write, the image must not be modified afterwards
+    // frames of a video must keep the size of the first one, the others are dropped
+    void submit(const SRef<datastructure::Image> & frame);
+
+    // write the queued frames, stop the writer thread and close the video
+    void close();
+
+    bool is_open() const { return m_writer.joinable(); }
+    frame_recorder_counters counters() const;
+
+private:
+    void write_frames();
+    bool write(const datastructure::Image & frame);
+    bool write_y4m(const datastructure::Image & frame);
+    bool write_ppm(const datastructure::Image & frame);
+
+    std::string m_path;
+    bool m_y4m = false;
+    size_t m_queue_size = 1;
+    drop_policy m_policy = DROP_NEWEST;
+    unsigned int m_frame_rate = 30;
+
+    std::thread m_writer;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_queued;
+    std::condition_variable m_dequeued;
+    std::deque<SRef<datastructure::Image>> m_queue;
+    frame_recorder_counters m_counters;
+    bool m_stop = false;
+
+    // only used by the writer thread
+    FILE * m_file = nullptr;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    std::vector<unsigned char> m_planes;
+    uint64_t m_index = 0;                                 // number of the next frame
+    bool m_size_warned = false;
+};
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef _TRIPLE_BUFFER_H
+#define _TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+// Wait-free single producer, single consumer triple buffer
+// The producer fills back() then publishes it, the consumer takes the most recent published value into front().
+// Neither side ever waits for the other: a value published while the previous one was not consumed replaces it,
+// and is counted as dropped.
+template <typename T>
+class triple_buffer {
+public:
+    triple_buffer() = default;
+    triple_buffer(const triple_buffer &) = delete;
+    triple_buffer & operator=(const triple_buffer &) = delete;
+
+    // producer side
+    T & back() { return m_buffers[m_back]; }
+    void publish()
+    {
+        uint8_t previous = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel);
+        if (previous & FRESH)
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+        m_back = previous & INDEX;
+        m_produced.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // consumer side, returns false if nothing was published since the last call
+    bool consume()
+    {
+        if (!fresh())
+            return false;
+        uint8_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = previous & INDEX;
+        m_consumed.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    T & front() { return m_buffers[m_front]; }
+
+    // a published value is waiting to be consumed
+    bool fresh() const { return (m_middle.load(std::memory_order_acquire) & FRESH) != 0; }
+
+    uint64_t produced() const { return m_produced.load(std::memory_order_relaxed); }
+    uint64_t consumed() const { return m_consumed.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    static const uint8_t INDEX = 0x3;
+    static const uint8_t FRESH = 0x4;
+
+    T m_buffers[3];
+    uint8_t m_back = 0;                                   // owned by the producer
+    uint8_t m_front = 1;                                  // owned by the consumer
+    std::atomic<uint8_t> m_middle{2};                     // exchanged by both, with the FRESH flag
+    std::atomic<uint64_t> m_produced{0};
+    std::atomic<uint64_t> m_consumed{0};
+    std::atomic<uint64_t> m_dropped{0};
+};
+
+}
+}
+}
+
+#endif
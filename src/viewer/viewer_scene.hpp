@@ -0,0 +1,41 @@
+#ifndef _VIEWER_SCENE_H
+#define _VIEWER_SCENE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "datastructure/MathDefinitions.h"
+
+#include "src/pointcloud/point_cloud_buffer.hpp"
+
+namespace SolAR {
+namespace MODULES {
+namespace OPENGL {
+
+// copy of the arguments of a call to display, handed over to the render thread
+// the cloud points are packed by the caller, the render thread never reads the CloudPoint objects it does not own
+struct viewer_scene {
+    bool arrays = false;                                  // the cloud is given by positions, colors and labels
+    packed_points points;
+    packed_points points2;
+    std::vector<float> positions;
+    std::vector<float> colors;                            // empty if not given
+    std::vector<int> labels;                              // empty if not given
+    datastructure::Transform3Df pose;
+    std::vector<datastructure::Transform3Df> keyframe_poses;
+    std::vector<datastructure::Transform3Df> frame_poses;
+    std::vector<datastructure::Transform3Df> keyframe_poses2;
+};
+
+// number of scenes given to display (produced), drawn (consumed) and replaced before being drawn (dropped)
+struct viewer_scene_counters {
+    uint64_t produced = 0;
+    uint64_t consumed = 0;
+    uint64_t dropped = 0;
+};
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,516 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <boost/log/core.hpp>
+
+// ADD COMPONENTS HEADERS HERE
+
+#include "xpcf/xpcf.h"
+
+#include "api/display/I3DPointsViewer.h"
+#include "core/Log.h"
+#include "SolAR3DPointsViewerOpengl.h"
+
+using namespace SolAR;
+using namespace SolAR::datastructure;
+using namespace SolAR::api;
+using SolAR::MODULES::OPENGL::SolAR3DPointsViewerOpengl;
+using SolAR::MODULES::OPENGL::stage_timing;
+
+namespace xpcf = org::bcom::xpcf;
+
+namespace {
+
+// display overload benchmarked
+enum class BenchmarkApi {
+    CLOUD_POINTS,                                         // vector of CloudPoint, retained and drawn again at each frame
+    ARRAYS                                                // structure of arrays, uploaded again at each frame
+};
+
+struct BenchmarkOptions {
+    std::vector<size_t> nbPoints;
+    std::vector<size_t> nbPoses;
+    std::vector<BenchmarkApi> apis = {BenchmarkApi::CLOUD_POINTS, BenchmarkApi::ARRAYS};
+    size_t maxCloudPoints = 10000000;                     // larger clouds are only benchmarked with the arrays
+    unsigned int nbFrames = 60;
+    unsigned int nbWarmupFrames = 5;
+    std::string jsonPath = "SolARTest_ModuleOpenGL_Benchmark.json";
+    std::string csvPath = "SolARTest_ModuleOpenGL_Benchmark.csv";
+};
+
+struct BenchmarkCase {
+    BenchmarkApi api;
+    size_t nbPoints;
+    size_t nbPoses;                                       // frame poses, a tenth of them are also keyframe poses
+};
+
+struct BenchmarkResult {
+    BenchmarkCase scene;
+    double firstDisplayMs = 0.0;                          // first call to display, with the packing and the upload of the whole cloud
+    double displayP50Ms = 0.0, displayP95Ms = 0.0, displayP99Ms = 0.0;
+    double fps = 0.0;
+    double uploadMB = 0.0;                                // data sent to the GPU at each frame, 0 if the cloud is retained
+    double uploadMs = 0.0;
+    double uploadGBps = 0.0;
+    double peakMemoryMB = 0.0;
+    std::vector<stage_timing> stages;
+};
+
+const char * apiName(BenchmarkApi api)
+{
+    return api == BenchmarkApi::CLOUD_POINTS ? "cloud_points" : "arrays";
+}
+
+void printUsage()
+{
+    std::cout << "usage: SolARTest_ModuleOpenGL_Benchmark [options]" << std::endl
+              << "  --points n1,n2,...    numbers of points of the synthetic clouds" << std::endl
+              << "  --poses n1,n2,...     numbers of frame poses (a tenth of them are keyframes)" << std::endl
+              << "  --api name            cloud_points, arrays or both (default)" << std::endl
+              << "  --max-cloud-points n  largest cloud benchmarked with CloudPoint objects (default 10000000)" << std::endl
+              << "  --frames n            measured frames per case (default 60)" << std::endl
+              << "  --warmup n            frames displayed before the measure (default 5)" << std::endl
+              << "  --json path           JSON results (default SolARTest_ModuleOpenGL_Benchmark.json, none if empty)" << std::endl
+              << "  --csv path            CSV results (default SolARTest_ModuleOpenGL_Benchmark.csv, none if empty)" << std::endl
+              << "Without --points and --poses, the clouds of 10k to 50M points are displayed with 100 poses," << std::endl
+              << "then the sets of 1k to 100k poses with a cloud of 10k points." << std::endl;
+}
+
+bool parseSize(const std::string & value, size_t & size)
+{
+    if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+    size = std::stoull(value);
+    return true;
+}
+
+bool parseSizes(const std::string & value, std::vector<size_t> & sizes)
+{
+    std::istringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        size_t size;
+        if (!parseSize(item, size) || size == 0)
+            return false;
+        sizes.push_back(size);
+    }
+    return !sizes.empty();
+}
+
+bool parseOptions(int argc, char **argv, BenchmarkOptions & options)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "--help") {
+            printUsage();
+            return false;
+        }
+        if (i + 1 >= argc) {
+            LOG_ERROR("Missing value of the option {}", option);
+            return false;
+        }
+        std::string value = argv[++i];
+        bool valid = true;
+        if (option == "--points")
+            valid = parseSizes(value, options.nbPoints);
+        else if (option == "--poses")
+            valid = parseSizes(value, options.nbPoses);
+        else if (option == "--api") {
+            if (value == "cloud_points")
+                options.apis = {BenchmarkApi::CLOUD_POINTS};
+            else if (value == "arrays")
+                options.apis = {BenchmarkApi::ARRAYS};
+            else
+                valid = value == "both";
+        }
+        else if (option == "--max-cloud-points")
+            valid = parseSize(value, options.maxCloudPoints);
+        else if (option == "--frames") {
+            size_t nbFrames;
+            valid = parseSize(value, nbFrames) && nbFrames > 0;
+            options.nbFrames = static_cast<unsigned int>(nbFrames);
+        }
+        else if (option == "--warmup") {
+            size_t nbWarmupFrames;
+            valid = parseSize(value, nbWarmupFrames);
+            options.nbWarmupFrames = static_cast<unsigned int>(nbWarmupFrames);
+        }
+        else if (option == "--json")
+            options.jsonPath = value;
+        else if (option == "--csv")
+            options.csvPath = value;
+        else {
+            LOG_ERROR("Unknown option {}", option);
+            printUsage();
+            return false;
+        }
+        if (!valid) {
+            LOG_ERROR("Invalid value {} of the option {}", value, option);
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<BenchmarkCase> benchmarkCases(const BenchmarkOptions & options)
+{
+    std::vector<std::pair<size_t, size_t>> scenes;
+    if (options.nbPoints.empty() && options.nbPoses.empty()) {
+        // cloud size sweep, then pose count sweep
+        for (size_t nbPoints : {10000, 100000, 1000000, 10000000, 50000000})
+            scenes.emplace_back(nbPoints, 100);
+        for (size_t nbPoses : {1000, 10000, 100000})
+            scenes.emplace_back(10000, nbPoses);
+    }
+    else {
+        std::vector<size_t> nbPoints = options.nbPoints.empty() ? std::vector<size_t>{10000} : options.nbPoints;
+        std::vector<size_t> nbPoses = options.nbPoses.empty() ? std::vector<size_t>{100} : options.nbPoses;
+        for (size_t points : nbPoints)
+            for (size_t poses : nbPoses)
+                scenes.emplace_back(points, poses);
+    }
+
+    std::vector<BenchmarkCase> cases;
+    for (const auto & scene : scenes)
+        for (BenchmarkApi api : options.apis) {
+            if (api == BenchmarkApi::CLOUD_POINTS && scene.first > options.maxCloudPoints) {
+                LOG_WARNING("The cloud of {} points is not benchmarked with CloudPoint objects (max-cloud-points is {})", scene.first, options.maxCloudPoints);
+                continue;
+            }
+            cases.push_back({api, scene.first, scene.second});
+        }
+    return cases;
+}
+
+// synthetic scene: a noisy ground plane and walls around the origin, colored by height
+void generatePoints(size_t nbPoints, std::vector<float> & positions, std::vector<float> & colors)
+{
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> horizontal(-10.f, 10.f);
+    std::uniform_real_distribution<float> height(0.f, 3.f);
+    std::normal_distribution<float> noise(0.f, 0.02f);
+    positions.resize(3 * nbPoints);
+    colors.resize(3 * nbPoints);
+    for (size_t i = 0; i < nbPoints; ++i) {
+        float x = horizontal(generator), y = noise(generator), z = horizontal(generator);
+        if (i % 2) {
+            // on one of the four walls
+            y = -height(generator);
+            float side = (i / 2) % 2 ? 10.f : -10.f;
+            if ((i / 4) % 2)
+                x = side + noise(generator);
+            else
+                z = side + noise(generator);
+        }
+        positions[3 * i] = x;
+        positions[3 * i + 1] = y;
+        positions[3 * i + 2] = z;
+        float level = -y / 3.f;
+        colors[3 * i] = level;
+        colors[3 * i + 1] = 1.f - level;
+        colors[3 * i + 2] = 0.5f;
+    }
+}
+
+std::vector<SRef<CloudPoint>> makeCloudPoints(const std::vector<float> & positions, const std::vector<float> & colors)
+{
+    std::map<unsigned int, unsigned int> visibility;
+    std::vector<SRef<CloudPoint>> points(positions.size() / 3);
+    for (size_t i = 0; i < points.size(); ++i) {
+        points[i] = xpcf::utils::make_shared<CloudPoint>(positions[3 * i], positions[3 * i + 1], positions[3 * i + 2],
+                                                         colors[3 * i], colors[3 * i + 1], colors[3 * i + 2], 0.0, visibility);
+        points[i]->setId(static_cast<uint32_t>(i));
+    }
+    return points;
+}
+
+// camera trajectory turning around the scene while looking at its center
+std::vector<Transform3Df> generatePoses(size_t nbPoses)
+{
+    std::vector<Transform3Df> poses(nbPoses);
+    for (size_t i = 0; i < nbPoses; ++i) {
+        float angle = 360.f * SOLAR_DEG2RAD * i / nbPoses;
+        float radius = 6.f + 2.f * std::sin(8.f * angle);
+        Transform3Df pose = Transform3Df::Identity();
+        pose.translate(datastructure::Vector3f(radius * std::sin(angle), -1.5f, -radius * std::cos(angle)));
+        pose.rotate(Maths::AngleAxisf(-angle, datastructure::Vector3f::UnitY()));
+        poses[i] = pose;
+    }
+    return poses;
+}
+
+// start the measure of the peak memory of a case, from the memory currently used by the process
+void resetPeakMemory()
+{
+#if defined(_WIN32)
+    // the peak working set can not be reset, the peak of a case is at least the one of the previous cases
+#elif defined(__linux__)
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+#endif
+}
+
+double peakMemoryMB()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize / (1024. * 1024.);
+    return 0.0;
+#else
+#if defined(__linux__)
+    // high water mark of the resident memory, reset by resetPeakMemory
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.compare(0, 6, "VmHWM:") == 0)
+            return std::stod(line.substr(6)) / 1024.;
+#endif
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / (1024. * 1024.);
+#else
+    return usage.ru_maxrss / 1024.;
+#endif
+#endif
+}
+
+double percentile(std::vector<double> values, double ratio)
+{
+    if (values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(ratio * values.size()))];
+}
+
+bool runCase(const SRef<xpcf::IComponentManager> & componentManager, const BenchmarkCase & scene,
+             const BenchmarkOptions & options, BenchmarkResult & result)
+{
+    using clock = std::chrono::steady_clock;
+
+    resetPeakMemory();
+    result.scene = scene;
+
+    std::vector<float> positions, colors;
+    generatePoints(scene.nbPoints, positions, colors);
+    std::vector<SRef<CloudPoint>> points;
+    if (scene.api == BenchmarkApi::CLOUD_POINTS) {
+        points = makeCloudPoints(positions, colors);
+        std::vector<float>().swap(positions);
+        std::vector<float>().swap(colors);
+    }
+    std::vector<Transform3Df> framePoses = generatePoses(scene.nbPoses);
+    std::vector<Transform3Df> keyframePoses;
+    for (size_t i = 0; i < framePoses.size(); i += 10)
+        keyframePoses.push_back(framePoses[i]);
+    const Transform3Df & cameraPose = framePoses.back();
+
+    // a new viewer for each case, so that its timings only cover this case
+    auto viewer3DPoints = componentManager->resolve<display::I3DPointsViewer>();
+    auto viewerComponent = std::dynamic_pointer_cast<SolAR3DPointsViewerOpengl>(viewer3DPoints);
+    if (!viewerComponent) {
+        LOG_ERROR("The 3D points viewer is not a SolAR3DPointsViewerOpengl");
+        return false;
+    }
+
+    auto display = [&]() {
+        if (scene.api == BenchmarkApi::CLOUD_POINTS)
+            return viewer3DPoints->display(points, cameraPose, keyframePoses, framePoses);
+        return viewerComponent->display(positions.data(), colors.data(), nullptr, scene.nbPoints, cameraPose, keyframePoses, framePoses);
+    };
+
+    clock::time_point start = clock::now();
+    if (display() != FrameworkReturnCode::_SUCCESS) {
+        LOG_ERROR("Failed to display the first frame of {} points with {}", scene.nbPoints, apiName(scene.api));
+        return false;
+    }
+    result.firstDisplayMs = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    for (unsigned int i = 0; i < options.nbWarmupFrames; ++i)
+        display();
+
+    std::vector<double> durations(options.nbFrames);
+    clock::time_point measureStart = clock::now();
+    for (unsigned int i = 0; i < options.nbFrames; ++i) {
+        start = clock::now();
+        if (display() != FrameworkReturnCode::_SUCCESS) {
+            LOG_ERROR("Failed to display the frame {} of {} points with {}", i, scene.nbPoints, apiName(scene.api));
+            return false;
+        }
+        durations[i] = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    }
+    double elapsed = std::chrono::duration<double>(clock::now() - measureStart).count();
+
+    result.displayP50Ms = percentile(durations, 0.50);
+    result.displayP95Ms = percentile(durations, 0.95);
+    result.displayP99Ms = percentile(durations, 0.99);
+    result.fps = elapsed > 0.0 ? options.nbFrames / elapsed : 0.0;
+    result.stages = viewerComponent->stageTimings();
+    if (scene.api == BenchmarkApi::ARRAYS) {
+        // positions and colors are sent again to the GPU by each call to display, before the rendering
+        result.uploadMB = scene.nbPoints * 6 * sizeof(float) / (1024. * 1024.);
+        // the upload stage holds the upload of the arrays and of the poses, once per frame
+        // drivers copy the data either in the call (CPU) or in the transfer (GPU), the longest of both is kept
+        for (const stage_timing & stage : result.stages)
+            if (stage.name == "upload")
+                result.uploadMs = stage.gpu_count > 0 ? std::max(stage.gpu_p50, stage.cpu_p50) : stage.cpu_p50;
+        if (result.uploadMs > 0.0)
+            result.uploadGBps = result.uploadMB / 1024. / (result.uploadMs / 1000.);
+    }
+
+    viewer3DPoints.reset();
+    viewerComponent.reset();
+    result.peakMemoryMB = peakMemoryMB();
+    return true;
+}
+
+void writeJson(const std::string & path, const BenchmarkOptions & options, const std::vector<BenchmarkResult> & results)
+{
+    std::ofstream file(path);
+    if (!file) {
+        LOG_ERROR("Failed to write the results to {}", path);
+        return;
+    }
+    file << std::fixed << std::setprecision(3);
+    file << "{" << std::endl
+         << "  \"benchmark\": \"SolARTest_ModuleOpenGL_Benchmark\"," << std::endl
+         << "  \"frames\": " << options.nbFrames << "," << std::endl
+         << "  \"warmup\": " << options.nbWarmupFrames << "," << std::endl
+         << "  \"results\": [" << std::endl;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult & result = results[i];
+        file << "    {" << std::endl
+             << "      \"api\": \"" << apiName(result.scene.api) << "\"," << std::endl
+             << "      \"points\": " << result.scene.nbPoints << "," << std::endl
+             << "      \"poses\": " << result.scene.nbPoses << "," << std::endl
+             << "      \"first_display_ms\": " << result.firstDisplayMs << "," << std::endl
+             << "      \"display_ms\": {\"p50\": " << result.displayP50Ms << ", \"p95\": " << result.displayP95Ms
+             << ", \"p99\": " << result.displayP99Ms << "}," << std::endl
+             << "      \"fps\": " << result.fps << "," << std::endl;
+        if (result.uploadMB > 0.0)
+            file << "      \"upload\": {\"mb\": " << result.uploadMB << ", \"ms\": " << result.uploadMs
+                 << ", \"gbps\": " << result.uploadGBps << "}," << std::endl;
+        else
+            file << "      \"upload\": null," << std::endl;
+        file << "      \"peak_memory_mb\": " << result.peakMemoryMB << "," << std::endl
+             << "      \"stages\": [" << std::endl;
+        for (size_t j = 0; j < result.stages.size(); ++j) {
+            const stage_timing & stage = result.stages[j];
+            file << "        {\"name\": \"" << stage.name << "\", \"cpu\": {\"count\": " << stage.cpu_count
+                 << ", \"p50\": " << stage.cpu_p50 << ", \"p95\": " << stage.cpu_p95 << ", \"p99\": " << stage.cpu_p99 << "}, \"gpu\": ";
+            if (stage.gpu_count > 0)
+                file << "{\"count\": " << stage.gpu_count << ", \"p50\": " << stage.gpu_p50
+                     << ", \"p95\": " << stage.gpu_p95 << ", \"p99\": " << stage.gpu_p99 << "}";
+            else
+                file << "null";
+            file << "}" << (j + 1 < result.stages.size() ? "," : "") << std::endl;
+        }
+        file << "      ]" << std::endl
+             << "    }" << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+    file << "  ]" << std::endl
+         << "}" << std::endl;
+}
+
+void writeCsv(const std::string & path, const std::vector<BenchmarkResult> & results)
+{
+    std::ofstream file(path);
+    if (!file) {
+        LOG_ERROR("Failed to write the results to {}", path);
+        return;
+    }
+    file << std::fixed << std::setprecision(3);
+    file << "api,points,poses,first_display_ms,display_p50_ms,display_p95_ms,display_p99_ms,fps,upload_mb,upload_ms,upload_gbps,peak_memory_mb" << std::endl;
+    for (const BenchmarkResult & result : results)
+        file << apiName(result.scene.api) << "," << result.scene.nbPoints << "," << result.scene.nbPoses << ","
+             << result.firstDisplayMs << "," << result.displayP50Ms << "," << result.displayP95Ms << "," << result.displayP99Ms << ","
+             << result.fps << "," << result.uploadMB << "," << result.uploadMs << "," << result.uploadGBps << ","
+             << result.peakMemoryMB << std::endl;
+}
+
+}
+
+int main(int argc, char **argv){
+
+#if NDEBUG
+    boost::log::core::get()->set_logging_enabled(false);
+#endif
+
+    LOG_ADD_LOG_TO_CONSOLE();
+
+    BenchmarkOptions options;
+    if (!parseOptions(argc, argv, options))
+        return -1;
+
+    try {
+
+        /* instantiate component manager*/
+        /* this is needed in dynamic mode */
+        SRef<xpcf::IComponentManager> xpcfComponentManager = xpcf::getComponentManagerInstance();
+
+        if(xpcfComponentManager->load("SolARTest_ModuleOpenGL_Benchmark_conf.xml")!=org::bcom::xpcf::_SUCCESS)
+        {
+            LOG_ERROR("Failed to load the configuration file SolARTest_ModuleOpenGL_Benchmark_conf.xml")
+            return -1;
+        }
+
+        std::vector<BenchmarkResult> results;
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << std::setw(14) << "api" << std::setw(10) << "points" << std::setw(8) << "poses"
+                  << std::setw(12) << "first ms" << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms"
+                  << std::setw(10) << "fps" << std::setw(10) << "GB/s" << std::setw(12) << "peak MB" << std::endl;
+        for (const BenchmarkCase & scene : benchmarkCases(options)) {
+            BenchmarkResult result;
+            if (!runCase(xpcfComponentManager, scene, options, result))
+                return -1;
+            results.push_back(result);
+            std::cout << std::setw(14) << apiName(scene.api) << std::setw(10) << scene.nbPoints << std::setw(8) << scene.nbPoses
+                      << std::setw(12) << result.firstDisplayMs << std::setw(10) << result.displayP50Ms << std::setw(10) << result.displayP99Ms
+                      << std::setw(10) << result.fps << std::setw(10) << result.uploadGBps << std::setw(12) << result.peakMemoryMB << std::endl;
+        }
+
+        if (!options.jsonPath.empty())
+            writeJson(options.jsonPath, options, results);
+        if (!options.csvPath.empty())
+            writeCsv(options.csvPath, results);
+    }
+    catch (xpcf::Exception e)
+    {
+        LOG_ERROR ("The following exception has been catched: {}", e.what());
+        return -1;
+    }
+
+    return 0;
+}